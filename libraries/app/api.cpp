@@ -89,7 +89,7 @@ namespace graphene { namespace app {
     {
        if( api_name == "database_api" )
        {
-          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ) );
+          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ), _app.get_api_object_cache() );
        }
        else if( api_name == "block_api" )
        {
@@ -495,15 +495,9 @@ namespace graphene { namespace app {
                   assert( aobj != nullptr );
                   result.push_back( aobj->owner );
                   break;
-               } case impl_transaction_object_type:{
-                  const auto& aobj = dynamic_cast<const transaction_object*>(obj);
-                  assert( aobj != nullptr );
-                  flat_set<account_id_type> impacted;
-                  transaction_get_impacted_accounts( aobj->trx, impacted );
-                  result.reserve( impacted.size() );
-                  for( auto& item : impacted ) result.emplace_back(item);
+               } case impl_transaction_object_type:
                   break;
-               } case impl_blinded_balance_object_type:{
+                 case impl_blinded_balance_object_type:{
                   const auto& aobj = dynamic_cast<const blinded_balance_object*>(obj);
                   assert( aobj != nullptr );
                   result.reserve( aobj->owner.account_auths.size() );
@@ -582,14 +576,8 @@ namespace graphene { namespace app {
 
         if(_app.is_plugin_enabled("elasticsearch")) {
            auto es = _app.get_plugin<elasticsearch::elasticsearch_plugin>("elasticsearch");
-           if(es.get()->get_running_mode() != elasticsearch::mode::only_save) {
-              if(!_app.elasticsearch_thread)
-                 _app.elasticsearch_thread= std::make_shared<fc::thread>("elasticsearch");
-
-              return _app.elasticsearch_thread->async([&es, &account, &stop, &limit, &start]() {
-                 return es->get_account_history(account, stop, limit, start);
-              }, "thread invoke for method " BOOST_PP_STRINGIZE(method_name)).wait();
-           }
+           if(es.get()->get_running_mode() != elasticsearch::mode::only_save)
+              return es->get_account_history(account, stop, limit, start);
         }
 
         const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
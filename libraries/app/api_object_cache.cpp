@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/api_object_cache.hpp>
+
+namespace graphene { namespace app {
+
+api_object_cache::api_object_cache( database& db, uint32_t capacity )
+   : _db( db ), _objects( capacity ), _full_accounts( capacity ),
+     _head_block_id( db.head_block_id() )
+{
+   _stats.capacity = capacity;
+   _new_connection = _db.new_objects.connect( [this]( const vector<object_id_type>& ids, const lazy_account_set& ) {
+      invalidate( ids );
+   });
+   _change_connection = _db.changed_objects.connect( [this]( const vector<object_id_type>& ids, const lazy_account_set& ) {
+      invalidate( ids );
+   });
+   _removed_connection = _db.removed_objects.connect( [this]( const vector<object_id_type>& ids, const vector<const object*>&,
+                                                              const lazy_account_set& ) {
+      invalidate( ids );
+   });
+   _applied_block_connection = _db.applied_block.connect( [this]( const signed_block& b ) { on_applied_block( b ); } );
+   _pending_trx_connection = _db.on_pending_transaction.connect( [this]( const signed_transaction& ) {
+      flush();
+      _pending_changes = true;
+   });
+}
+
+const fc::variant* api_object_cache::find_object( object_id_type id )
+{
+   const fc::variant* result = _objects.find( id );
+   ++( result ? _stats.hits : _stats.misses );
+   return result;
+}
+
+void api_object_cache::store_object( object_id_type id, const fc::variant& obj )
+{
+   _objects.store( id, obj );
+}
+
+const full_account* api_object_cache::find_full_account( account_id_type id )
+{
+   const full_account* result = _full_accounts.find( id );
+   ++( result ? _stats.hits : _stats.misses );
+   return result;
+}
+
+void api_object_cache::store_full_account( account_id_type id, const full_account& acnt )
+{
+   _full_accounts.store( id, acnt );
+}
+
+api_object_cache_stats api_object_cache::get_stats()const
+{
+   api_object_cache_stats result = _stats;
+   result.size = _objects.size() + _full_accounts.size();
+   return result;
+}
+
+void api_object_cache::invalidate( const vector<object_id_type>& ids )
+{
+   for( const object_id_type& id : ids )
+      if( _objects.erase( id ) )
+         ++_stats.invalidations;
+}
+
+void api_object_cache::on_applied_block( const signed_block& b )
+{
+   // a block that doesn't extend the one we saw last means blocks were popped, which reports no changes
+   if( _pending_changes || b.previous != _head_block_id )
+      flush();
+   else
+   {
+      _stats.invalidations += _full_accounts.size();
+      _full_accounts.clear();
+   }
+   _head_block_id = b.id();
+   _pending_changes = false;
+}
+
+void api_object_cache::flush()
+{
+   _stats.invalidations += _objects.size() + _full_accounts.size();
+   _objects.clear();
+   _full_accounts.clear();
+}
+
+} } // graphene::app
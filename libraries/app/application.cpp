@@ -24,6 +24,7 @@
 #include <graphene/app/api.hpp>
 #include <graphene/app/api_access.hpp>
 #include <graphene/app/application.hpp>
+#include <graphene/app/block_message_cache.hpp>
 #include <graphene/app/plugin.hpp>
 
 #include <graphene/chain/protocol/fee_schedule.hpp>
@@ -33,6 +34,7 @@
 
 #include <graphene/net/core_messages.hpp>
 #include <graphene/net/exceptions.hpp>
+#include <graphene/net/stcp_socket.hpp>
 
 #include <graphene/utilities/key_conversion.hpp>
 #include <graphene/chain/worker_evaluator.hpp>
@@ -215,6 +217,9 @@ namespace detail {
             }
          }
 
+         net::stcp_socket::enable_cipher_offload( _options->count("p2p-cipher-offload")
+                                                  && _options->at("p2p-cipher-offload").as<bool>() );
+
          if( _options->count("p2p-endpoint") )
             _p2p_network->listen_on_endpoint(fc::ip::endpoint::from_string(_options->at("p2p-endpoint").as<string>()), true);
          else
@@ -410,6 +415,41 @@ namespace detail {
          {
             _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
          }
+
+         if( _options->count("mmap-block-log") )
+         {
+            _chain_db->enable_mmap_block_reads( _options->at("mmap-block-log").as<bool>() );
+         }
+
+         if( _options->count("replay-threads") )
+         {
+            _chain_db->set_replay_threads( _options->at("replay-threads").as<uint32_t>() );
+         }
+
+         if( _options->count("signature-recovery-threads") )
+         {
+            _chain_db->set_signature_recovery_threads( _options->at("signature-recovery-threads").as<uint32_t>() );
+         }
+
+         if( _options->count("vote-tally-threads") )
+         {
+            _chain_db->set_vote_tally_threads( _options->at("vote-tally-threads").as<uint32_t>() );
+         }
+
+         if( _options->count("checkpoint-deltas") )
+         {
+            _chain_db->set_max_checkpoint_deltas( _options->at("checkpoint-deltas").as<uint32_t>() );
+         }
+
+         if( _options->count("checkpoint-threads") )
+         {
+            _chain_db->set_checkpoint_threads( _options->at("checkpoint-threads").as<uint32_t>() );
+         }
+
+         if( _options->count("p2p-block-cache-size") )
+         {
+            _block_message_cache.set_capacity( _options->at("p2p-block-cache-size").as<uint32_t>() );
+         }
          
          bool replay = false;
          std::string replay_reason = "reason not provided";
@@ -427,6 +467,12 @@ namespace detail {
             throw;
          }
 
+         if( _options->count("api-object-cache-size") && _options->at("api-object-cache-size").as<uint32_t>() > 0 )
+         {
+            _api_object_cache = std::make_shared<api_object_cache>( *_chain_db,
+                                                                    _options->at("api-object-cache-size").as<uint32_t>() );
+         }
+
          if( _options->count("force-validate") )
          {
             ilog( "All transaction signatures will be validated" );
@@ -662,13 +708,7 @@ namespace detail {
         // ilog("Request for item ${id}", ("id", id));
          if( id.item_type == graphene::net::block_message_type )
          {
-            auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
-            if( !opt_block )
-               elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
-                    ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
-            FC_ASSERT( opt_block.valid() );
-            // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-            return block_message(std::move(*opt_block));
+            return _block_message_cache.get_block_message( *_chain_db, id.item_hash );
          }
          return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
       } FC_CAPTURE_AND_RETHROW( (id) ) }
@@ -918,6 +958,8 @@ namespace detail {
       api_access _apiaccess;
 
       std::shared_ptr<graphene::chain::database>            _chain_db;
+      std::shared_ptr<api_object_cache>                     _api_object_cache;
+      block_message_cache                                   _block_message_cache;
       std::shared_ptr<graphene::net::node>                  _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
@@ -941,6 +983,7 @@ application::~application()
       my->_p2p_network->close();
       my->_p2p_network.reset();
    }
+   net::stcp_socket::enable_cipher_offload( false );
    if( my->_chain_db )
    {
       my->_chain_db->close();
@@ -952,6 +995,8 @@ void application::set_program_options(boost::program_options::options_descriptio
 {
    configuration_file_options.add_options()
          ("p2p-endpoint", bpo::value<string>(), "Endpoint for P2P node to listen on")
+         ("p2p-cipher-offload", bpo::value<bool>()->default_value(false),
+          "Encrypt and decrypt large P2P messages on a separate thread instead of the P2P thread")
          ("seed-node,s", bpo::value<vector<string>>()->composing(), "P2P nodes to connect to on startup (may specify multiple times)")
          ("seed-nodes", bpo::value<string>()->composing(), "JSON array of P2P nodes to connect to on startup")
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
@@ -965,6 +1010,28 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("mmap-block-log", bpo::value<bool>()->implicit_value(true),
+          "Whether to serve block lookups from memory mapped block log files. "
+          "Lets API and P2P block reads run concurrently without copying, at the cost of an extra flush per stored block.")
+         ("replay-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads reading, decoding and pre-validating blocks ahead of the apply thread during replay. "
+          "0 replays serially.")
+         ("signature-recovery-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads recovering the signature keys of all transactions in a block in parallel before "
+          "the block is applied. 0 recovers them one by one while applying.")
+         ("api-object-cache-size", bpo::value<uint32_t>()->default_value(0),
+          "Number of serialized objects and full accounts kept for the database API of all clients. 0 disables "
+          "the cache.")
+         ("vote-tally-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads counting votes during chain maintenance. 0 counts them one account at a time.")
+         ("checkpoint-deltas", bpo::value<uint32_t>()->default_value(16),
+          "Number of incremental object database checkpoints, holding only the objects changed since the previous "
+          "one, to write before compacting them into a full checkpoint. 0 always writes full checkpoints.")
+         ("checkpoint-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads loading and saving object database indexes concurrently, with large indexes split "
+          "into chunks. 0 loads and saves them one after another.")
+         ("p2p-block-cache-size", bpo::value<uint32_t>()->default_value(1024),
+          "Number of recently requested blocks kept ready to be sent to peers. 0 disables the cache.")
          ("plugins", bpo::value<string>(), "Space-separated list of plugins to activate")
          ;
    command_line_options.add(configuration_file_options);
@@ -1076,6 +1143,16 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+std::shared_ptr<api_object_cache> application::get_api_object_cache() const
+{
+   return my->_api_object_cache;
+}
+
+const fc::path& application::data_dir() const
+{
+   return my->_data_dir;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -1118,6 +1195,7 @@ void application::shutdown()
 {
    if( my->_p2p_network )
       my->_p2p_network->close();
+   net::stcp_socket::enable_cipher_offload( false );
    if( my->_chain_db )
       my->_chain_db->close();
 }
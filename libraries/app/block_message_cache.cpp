@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/block_message_cache.hpp>
+
+#include <graphene/net/core_messages.hpp>
+
+namespace graphene { namespace app {
+
+void block_message_cache::set_capacity( size_t capacity )
+{
+   _capacity = capacity;
+   while( _entries.size() > _capacity )
+      _entries.pop_back();
+}
+
+net::message block_message_cache::get_block_message( const graphene::chain::database& db, const block_id_type& id )
+{
+   // serve the block as stored instead of unpacking and repacking it into a block_message
+   net::message result;
+   result.msg_type = net::block_message::type;
+   if( !find( id, result.data ) )
+   {
+      auto packed_block = db.fetch_packed_block_by_id( id );
+      if( !packed_block )
+         elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
+              ("id", id)("id2", db.get_block_id_for_num(graphene::chain::block_header::num_from_id(id))));
+      FC_ASSERT( packed_block.valid() );
+      // a packed block_message is the packed block followed by the block id
+      result.data = std::move( *packed_block );
+      const auto packed_id = fc::raw::pack( id );
+      result.data.insert( result.data.end(), packed_id.begin(), packed_id.end() );
+      insert( id, result.data );
+   }
+   result.size = (uint32_t)result.data.size();
+   return result;
+}
+
+bool block_message_cache::find( const block_id_type& id, std::vector<char>& data )
+{
+   auto& by_id = _entries.get<by_block_id>();
+   auto itr = by_id.find( id );
+   if( itr == by_id.end() )
+      return false;
+   data = itr->data;
+   _entries.relocate( _entries.begin(), _entries.project<0>( itr ) );
+   return true;
+}
+
+void block_message_cache::insert( const block_id_type& id, const std::vector<char>& data )
+{
+   if( _capacity == 0 )
+      return;
+   auto result = _entries.push_front( entry{ id, data } );
+   if( !result.second )
+      _entries.relocate( _entries.begin(), result.first );
+   while( _entries.size() > _capacity )
+      _entries.pop_back();
+}
+
+} } // graphene::app
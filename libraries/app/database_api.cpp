@@ -95,11 +95,13 @@ class database_api_impl;
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
-      database_api_impl( graphene::chain::database& db );
+      database_api_impl( graphene::chain::database& db, std::shared_ptr<api_object_cache> cache );
       ~database_api_impl();
 
       // Objects
       fc::variants get_objects(const vector<object_id_type>& ids)const;
+      api_object_cache_stats get_object_cache_stats()const;
+      pending_transactions_stats get_pending_transactions_stats()const;
 
       // Subscriptions
       void set_subscribe_callback( std::function<void(const variant&)> cb, bool notify_remove_create );
@@ -251,11 +253,12 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
          return _subscribe_filter.contains( i );
       }
 
-      bool is_impacted_account( const flat_set<account_id_type>& accounts)
+      bool is_impacted_account( const lazy_account_set& impacted_accounts )
       {
-         if( !_subscribed_accounts.size() || !accounts.size() )
+         if( !_subscribed_accounts.size() )
             return false;
 
+         const flat_set<account_id_type>& accounts = impacted_accounts.get();
          return std::any_of(accounts.begin(), accounts.end(), [this](const account_id_type& account) {
             return _subscribed_accounts.find(account) != _subscribed_accounts.end();
          });
@@ -277,12 +280,12 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
       void broadcast_updates( const vector<variant>& updates );
       void broadcast_market_updates( const market_queue_type& queue);
-      void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object);
+      void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts, std::function<const object*(object_id_type id)> find_object);
 
       /** called every time a block is applied to report the objects that were changed */
-      void on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts);
+      void on_objects_new(const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts);
+      void on_objects_changed(const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts);
+      void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const lazy_account_set& impacted_accounts);
       void on_applied_block();
 
       bool _notify_remove_create = false;
@@ -299,6 +302,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       boost::signals2::scoped_connection                                                                                           _pending_trx_connection;
       map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> >      _market_subscriptions;
       graphene::chain::database&                                                                                                            _db;
+      std::shared_ptr<api_object_cache>                                                                                                     _cache;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -307,21 +311,22 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
 
-database_api::database_api( graphene::chain::database& db )
-   : my( new database_api_impl( db ) ) {}
+database_api::database_api( graphene::chain::database& db, std::shared_ptr<api_object_cache> cache )
+   : my( new database_api_impl( db, cache ) ) {}
 
 database_api::~database_api() {}
 
-database_api_impl::database_api_impl( graphene::chain::database& db ):_db(db)
+database_api_impl::database_api_impl( graphene::chain::database& db, std::shared_ptr<api_object_cache> cache )
+   :_db(db), _cache(cache)
 {
    wlog("creating database api ${x}", ("x",int64_t(this)) );
-   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
+   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts) {
                                 on_objects_new(ids, impacted_accounts);
                                 });
-   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
+   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts) {
                                 on_objects_changed(ids, impacted_accounts);
                                 });
-   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) {
+   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const lazy_account_set& impacted_accounts) {
                                 on_objects_removed(ids, objs, impacted_accounts);
                                 });
    _applied_block_connection = _db.applied_block.connect([this](const signed_block&){ on_applied_block(); });
@@ -364,14 +369,46 @@ fc::variants database_api_impl::get_objects(const vector<object_id_type>& ids)co
 
    std::transform(ids.begin(), ids.end(), std::back_inserter(result),
                   [this](object_id_type id) -> fc::variant {
+      if( _cache )
+      {
+         if( const fc::variant* cached = _cache->find_object(id) )
+            return *cached;
+      }
       if(auto obj = _db.find_object(id))
-         return obj->to_variant();
+      {
+         fc::variant v = obj->to_variant();
+         if( _cache )
+            _cache->store_object(id, v);
+         return v;
+      }
       return {};
    });
 
    return result;
 }
 
+api_object_cache_stats database_api::get_object_cache_stats()const
+{
+   return my->get_object_cache_stats();
+}
+
+api_object_cache_stats database_api_impl::get_object_cache_stats()const
+{
+   if( _cache )
+      return _cache->get_stats();
+   return api_object_cache_stats();
+}
+
+pending_transactions_stats database_api::get_pending_transactions_stats()const
+{
+   return my->get_pending_transactions_stats();
+}
+
+pending_transactions_stats database_api_impl::get_pending_transactions_stats()const
+{
+   return _db.get_pending_transactions_stats();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Subscriptions                                                    //
@@ -761,6 +798,15 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
          subscribe_to_item( account->id );
       }
 
+      if( _cache )
+      {
+         if( const full_account* cached = _cache->find_full_account( account->id ) )
+         {
+            results[account_name_or_id] = *cached;
+            continue;
+         }
+      }
+
       full_account acnt;
       acnt.account = *account;
       acnt.statistics = account->statistics(_db);
@@ -831,6 +877,8 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
 
       std::copy(pending_payouts_range.first, pending_payouts_range.second, std::back_inserter(acnt.pending_dividend_payments));
 
+      if( _cache )
+         _cache->store_full_account( account->id, acnt );
       results[account_name_or_id] = acnt;
    }
    return results;
@@ -1487,39 +1535,31 @@ market_ticker database_api_impl::get_ticker( const string& base, const string& q
     result.quote_volume = 0;
 
     try {
-        const fc::time_point_sec now = fc::time_point::now();
-        const fc::time_point_sec yesterday = fc::time_point_sec( now.sec_since_epoch() - 86400 );
-        const auto batch_size = 100;
+        auto base_id = assets[0]->id;
+        auto quote_id = assets[1]->id;
+        if( base_id > quote_id ) std::swap( base_id, quote_id );
 
-        vector<market_trade> trades = get_trade_history( base, quote, now, yesterday, batch_size );
-        if( !trades.empty() )
+        const auto& ticker_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_market>();
+        auto itr = ticker_idx.find( boost::make_tuple( base_id, quote_id ) );
+        if( itr != ticker_idx.end() )
         {
-            result.latest = trades[0].price;
-
-            while( !trades.empty() )
-            {
-                for( const market_trade& t: trades )
-                {
-                    result.base_volume += t.value;
-                    result.quote_volume += t.amount;
-                }
+            // the ticker is kept with the lower asset id as base
+            const bool flipped = ( assets[0]->id != itr->base );
+            auto to_real = [&]( const share_type a, int p ) { return double( a.value ) / pow( 10, p ); };
+            auto base_real = [&]( share_type b, share_type q ) { return to_real( flipped ? q : b, assets[0]->precision ); };
+            auto quote_real = [&]( share_type b, share_type q ) { return to_real( flipped ? b : q, assets[1]->precision ); };
 
-                trades = get_trade_history( base, quote, trades.back().date, yesterday, batch_size );
-            }
+            result.latest = base_real( itr->latest_base, itr->latest_quote ) / quote_real( itr->latest_base, itr->latest_quote );
+            result.base_volume = base_real( itr->base_volume, itr->quote_volume );
+            result.quote_volume = quote_real( itr->base_volume, itr->quote_volume );
 
-            const auto last_trade_yesterday = get_trade_history( base, quote, yesterday, fc::time_point_sec(), 1 );
-            if( !last_trade_yesterday.empty() )
+            if( !itr->buckets.empty() && itr->last_day_quote != 0 )
             {
-                const auto price_yesterday = last_trade_yesterday[0].price;
+                const auto price_yesterday = base_real( itr->last_day_base, itr->last_day_quote )
+                                             / quote_real( itr->last_day_base, itr->last_day_quote );
                 result.percent_change = ( (result.latest / price_yesterday) - 1 ) * 100;
             }
         }
-        else
-        {
-            const auto last_trade = get_trade_history( base, quote, now, fc::time_point_sec(), 1 );
-            if( !last_trade.empty() )
-                result.latest = last_trade[0].price;
-        }
 
         const auto orders = get_order_book( base, quote, 1 );
         if( !orders.asks.empty() ) result.lowest_ask = orders.asks[0].price;
@@ -2409,7 +2449,7 @@ void database_api_impl::broadcast_market_updates( const market_queue_type& queue
    }
 }
 
-void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts)
+void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const lazy_account_set& impacted_accounts)
 {
    handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
       [objs](object_id_type id) -> const object* {
@@ -2425,21 +2465,21 @@ void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, c
    );
 }
 
-void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
+void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts)
 {
    handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
 }
 
-void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
+void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts)
 {
    handle_object_changed(false, true, ids, impacted_accounts,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
 }
 
-void database_api_impl::handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object)
+void database_api_impl::handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts, std::function<const object*(object_id_type id)> find_object)
 {
    if( _subscribe_callback )
    {
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/app/full_account.hpp>
+#include <graphene/chain/database.hpp>
+
+#include <boost/signals2/connection.hpp>
+
+#include <list>
+#include <unordered_map>
+
+namespace graphene { namespace app {
+   using namespace graphene::chain;
+
+   struct api_object_cache_stats
+   {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      /// entries dropped because the objects they were built from changed
+      uint64_t invalidations = 0;
+      uint32_t size = 0;
+      uint32_t capacity = 0;
+   };
+
+   namespace detail {
+      /** map holding at most capacity entries, dropping the least recently used one when full */
+      template<typename Key, typename Value>
+      class lru_map
+      {
+         public:
+            explicit lru_map( size_t capacity ) : _capacity( capacity ) {}
+
+            const Value* find( const Key& key )
+            {
+               auto itr = _lookup.find( key );
+               if( itr == _lookup.end() )
+                  return nullptr;
+               _entries.splice( _entries.begin(), _entries, itr->second );
+               return &itr->second->second;
+            }
+            void store( const Key& key, const Value& value )
+            {
+               erase( key );
+               _entries.emplace_front( key, value );
+               _lookup[key] = _entries.begin();
+               if( _entries.size() > _capacity )
+               {
+                  _lookup.erase( _entries.back().first );
+                  _entries.pop_back();
+               }
+            }
+            bool erase( const Key& key )
+            {
+               auto itr = _lookup.find( key );
+               if( itr == _lookup.end() )
+                  return false;
+               _entries.erase( itr->second );
+               _lookup.erase( itr );
+               return true;
+            }
+            void   clear() { _entries.clear(); _lookup.clear(); }
+            size_t size()const { return _entries.size(); }
+
+         private:
+            typedef std::list< std::pair<Key, Value> > entry_list;
+            size_t                                                   _capacity;
+            entry_list                                               _entries;
+            std::unordered_map<Key, typename entry_list::iterator>  _lookup;
+      };
+   }
+
+   /**
+    * Serialized objects and assembled full accounts served by the database API, shared by all API sessions.
+    *
+    * Objects are dropped as soon as the database reports them new, changed or removed after a block. Full accounts
+    * are built from many objects and are only reused within the block they were built in. Pending transactions
+    * don't report what they changed and are undone when the next block arrives, so the whole cache is flushed
+    * when one is applied and again with the next block, as it is on a chain reorganization.
+    */
+   class api_object_cache
+   {
+      public:
+         api_object_cache( database& db, uint32_t capacity );
+
+         const fc::variant*  find_object( object_id_type id );
+         void                store_object( object_id_type id, const fc::variant& obj );
+         const full_account* find_full_account( account_id_type id );
+         void                store_full_account( account_id_type id, const full_account& acnt );
+
+         api_object_cache_stats get_stats()const;
+
+      private:
+         void invalidate( const vector<object_id_type>& ids );
+         void on_applied_block( const signed_block& b );
+         void flush();
+
+         database&                                           _db;
+         detail::lru_map<object_id_type, fc::variant>        _objects;
+         detail::lru_map<object_id_type, full_account>       _full_accounts;
+         block_id_type                                       _head_block_id;
+         /// set while entries may reflect pending transactions, which the next block undoes without notice
+         bool                                                _pending_changes = false;
+         api_object_cache_stats                              _stats;
+
+         boost::signals2::scoped_connection                  _new_connection;
+         boost::signals2::scoped_connection                  _change_connection;
+         boost::signals2::scoped_connection                  _removed_connection;
+         boost::signals2::scoped_connection                  _applied_block_connection;
+         boost::signals2::scoped_connection                  _pending_trx_connection;
+   };
+
+} }
+
+FC_REFLECT( graphene::app::api_object_cache_stats, (hits)(misses)(invalidations)(size)(capacity) )
@@ -34,6 +34,7 @@ namespace graphene { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class api_object_cache;
 
    class application
    {
@@ -80,6 +81,10 @@ namespace graphene { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         /// cache shared by the database API sessions, null unless api-object-cache-size is set
+         std::shared_ptr<api_object_cache> get_api_object_cache()const;
+         /// directory containing the databases, valid from initialize() on
+         const fc::path&                  data_dir()const;
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
@@ -93,8 +98,6 @@ namespace graphene { namespace app {
 
          bool is_plugin_enabled(const string& name) const;
 
-         std::shared_ptr<fc::thread> elasticsearch_thread;
-
    private:
          void add_available_plugin( std::shared_ptr<abstract_plugin> p );
          std::shared_ptr<detail::application_impl> my;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+#include <graphene/net/message.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+namespace graphene { namespace app {
+   using graphene::chain::block_id_type;
+
+   /**
+    * Keeps the packed block_messages most recently served to peers, so syncing peers asking for the
+    * same blocks do not cause them to be read and packed again.  Block ids cover the whole signed
+    * block, so entries never go stale.
+    */
+   class block_message_cache
+   {
+   public:
+      void set_capacity( size_t capacity );
+
+      /**
+       * @return the block_message for block @p id, from the cache or built from the block as stored
+       * in @p db.  Throws if @p db does not know the block.
+       */
+      net::message get_block_message( const graphene::chain::database& db, const block_id_type& id );
+
+      /// copies the cached message data of @p id into @p data and marks it as most recently used
+      bool find( const block_id_type& id, std::vector<char>& data );
+      void insert( const block_id_type& id, const std::vector<char>& data );
+
+      size_t size()const { return _entries.size(); }
+
+   private:
+      struct entry
+      {
+         block_id_type     id;
+         std::vector<char> data;
+      };
+      struct by_block_id;
+      typedef boost::multi_index_container<
+         entry,
+         boost::multi_index::indexed_by<
+            boost::multi_index::sequenced<>,
+            boost::multi_index::hashed_unique< boost::multi_index::tag<by_block_id>,
+               boost::multi_index::member< entry, block_id_type, &entry::id >, std::hash<fc::ripemd160> >
+         >
+      > entry_container;
+
+      entry_container _entries;
+      size_t          _capacity = 1024;
+   };
+
+} }
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <graphene/app/full_account.hpp>
+#include <graphene/app/api_object_cache.hpp>
 
 #include <graphene/chain/protocol/types.hpp>
 
@@ -134,7 +135,7 @@ struct gpos_info {
 class database_api
 {
    public:
-      database_api(graphene::chain::database& db);
+      database_api(graphene::chain::database& db, std::shared_ptr<api_object_cache> cache = nullptr);
       ~database_api();
 
       /////////////
@@ -150,6 +151,18 @@ class database_api
        */
       fc::variants get_objects(const vector<object_id_type>& ids)const;
 
+      /**
+       * @brief Get the hit and miss counts of the object cache shared by the API sessions of this node
+       *
+       * All counters are zero if the node was started without api-object-cache-size.
+       */
+      api_object_cache_stats get_object_cache_stats()const;
+
+      /**
+       * @brief Get the size of the pending transaction pool and how often it was applied again
+       */
+      pending_transactions_stats get_pending_transactions_stats()const;
+
       ///////////////////
       // Subscriptions //
       ///////////////////
@@ -736,6 +749,8 @@ FC_REFLECT( graphene::app::gpos_info, (vesting_factor)(award)(total_amount)(curr
 FC_API(graphene::app::database_api,
    // Objects
    (get_objects)
+   (get_object_cache_stats)
+   (get_pending_transactions_stats)
 
    // Subscriptions
    (set_subscribe_callback)
@@ -464,6 +464,65 @@ void betting_market_object::on_canceled_event(database& db)
    my->state_machine.process_event(canceled_event(db));
 }
 
+void bet_price_level_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const bet_object*>(&obj) );
+   add( static_cast<const bet_object&>(obj) );
+}
+
+void bet_price_level_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const bet_object*>(&obj) );
+   subtract( static_cast<const bet_object&>(obj) );
+}
+
+void bet_price_level_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const bet_object*>(&before) );
+   subtract( static_cast<const bet_object&>(before) );
+}
+
+void bet_price_level_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const bet_object*>(&after) );
+   add( static_cast<const bet_object&>(after) );
+}
+
+const bet_price_level_index::side_levels* bet_price_level_index::get_levels( betting_market_id_type betting_market_id,
+                                                                            bet_type back_or_lay )const
+{
+   auto itr = _levels.find( std::make_pair( betting_market_id, back_or_lay ) );
+   return itr != _levels.end() ? &itr->second : nullptr;
+}
+
+void bet_price_level_index::add( const bet_object& bet )
+{
+   if( bet.end_of_delay )
+      return;
+   price_level& level = _levels[std::make_pair( bet.betting_market_id, bet.back_or_lay )][bet.backer_multiplier];
+   level.amount_to_bet += bet.amount_to_bet.amount;
+   ++level.bet_count;
+}
+
+void bet_price_level_index::subtract( const bet_object& bet )
+{
+   if( bet.end_of_delay )
+      return;
+   auto side_itr = _levels.find( std::make_pair( bet.betting_market_id, bet.back_or_lay ) );
+   if( side_itr == _levels.end() )
+      return;
+   auto level_itr = side_itr->second.find( bet.backer_multiplier );
+   if( level_itr == side_itr->second.end() )
+      return;
+   level_itr->second.amount_to_bet -= bet.amount_to_bet.amount;
+   if( --level_itr->second.bet_count == 0 )
+   {
+      side_itr->second.erase( level_itr );
+      if( side_itr->second.empty() )
+         _levels.erase( side_itr );
+   }
+}
+
 } } // graphene::chain
 
 namespace fc { 
@@ -26,6 +26,8 @@
 #include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <cstring>
+
 namespace graphene { namespace chain {
 
 struct index_entry
@@ -39,22 +41,30 @@ FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
 namespace graphene { namespace chain {
 
+block_database::mapped_file::mapped_file( const fc::path& file, uint64_t size )
+   : mapping( file.generic_string().c_str(), fc::read_only ),
+     region( mapping, fc::read_only, 0, size )
+{
+}
+
 void block_database::open( const fc::path& dbdir )
 { try {
    fc::create_directories(dbdir);
    _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+   reset_mappings();
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
@@ -65,6 +75,7 @@ bool block_database::is_open()const
 
 void block_database::close()
 {
+  reset_mappings();
   _blocks.close();
   _block_num_to_pos.close();
 }
@@ -92,7 +103,16 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
    e.block_size = vec.size();
    e.block_id   = id;
    _blocks.write( vec.data(), vec.size() );
-   _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   if( _use_mmap )
+   {
+      // mapped readers only see what has reached the file, and must never find
+      // an index entry pointing at block data that is still in the stream buffer
+      _blocks.flush();
+      _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      _block_num_to_pos.flush();
+   }
+   else
+      _block_num_to_pos.write( (char*)&e, sizeof(e) );
 }
 
 void block_database::remove( const block_id_type& id )
@@ -111,6 +131,8 @@ void block_database::remove( const block_id_type& id )
       e.block_size = 0;
       _block_num_to_pos.seekp( sizeof(e)*block_header::num_from_id(id) );
       _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      if( _use_mmap )
+         _block_num_to_pos.flush();
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -120,6 +142,9 @@ bool block_database::contains( const block_id_type& id )const
       return false;
 
    index_entry e;
+   if( _use_mmap )
+      return read_mapped_index_entry( block_header::num_from_id(id), e ) && e.block_id == id && e.block_size > 0;
+
    auto index_pos = sizeof(e)*block_header::num_from_id(id);
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() < index_pos + sizeof(e) )
@@ -134,6 +159,14 @@ block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
    index_entry e;
+   if( _use_mmap )
+   {
+      if( !read_mapped_index_entry( block_num, e ) )
+         FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+      FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
+      return e.block_id;
+   }
+
    auto index_pos = sizeof(e)*block_num;
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() <= int64_t(index_pos) )
@@ -151,6 +184,13 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
    try
    {
       index_entry e;
+      if( _use_mmap )
+      {
+         if( !read_mapped_index_entry( block_header::num_from_id(id), e ) || e.block_id != id )
+            return optional<signed_block>();
+         return unpack_mapped_block( e );
+      }
+
       auto index_pos = sizeof(e)*block_header::num_from_id(id);
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -178,11 +218,58 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
    return optional<signed_block>();
 }
 
+optional< vector<char> > block_database::fetch_packed( const block_id_type& id )const
+{
+   try
+   {
+      index_entry e;
+      if( _use_mmap )
+      {
+         if( !read_mapped_index_entry( block_header::num_from_id(id), e ) || e.block_id != id || e.block_size == 0 )
+            return optional< vector<char> >();
+         mapped_file_ptr blocks = map_range( _blocks_filename, _blocks_map, e.block_pos + e.block_size );
+         FC_ASSERT( blocks, "Block ${id} points past the end of the blocks file", ("id", e.block_id) );
+         const char* begin = blocks->data() + e.block_pos;
+         return vector<char>( begin, begin + e.block_size );
+      }
+
+      auto index_pos = sizeof(e)*block_header::num_from_id(id);
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      if ( _block_num_to_pos.tellg() <= index_pos )
+         return {};
+
+      _block_num_to_pos.seekg( index_pos );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+
+      if( e.block_id != id || e.block_size == 0 ) return optional< vector<char> >();
+
+      vector<char> data( e.block_size );
+      _blocks.seekg( e.block_pos );
+      _blocks.read( data.data(), e.block_size );
+      FC_ASSERT( _blocks, "Failed to read block ${id}", ("id", id) );
+      return data;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional< vector<char> >();
+}
+
 optional<signed_block> block_database::fetch_by_number( uint32_t block_num )const
 {
    try
    {
       index_entry e;
+      if( _use_mmap )
+      {
+         if( !read_mapped_index_entry( block_num, e ) )
+            return optional<signed_block>();
+         return unpack_mapped_block( e );
+      }
+
       auto index_pos = sizeof(e)*block_num;
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -246,6 +333,9 @@ optional<index_entry> block_database::last_index_entry()const {
             catch (const std::exception&)
             {
             }
+         // drop the mappings before shrinking the file, touching mapped pages past the
+         // new end of file would fault
+         reset_mappings();
          fc::resize_file( _index_filename, pos );
       }
    }
@@ -272,4 +362,59 @@ optional<block_id_type> block_database::last_id()const
    return optional<block_id_type>();
 }
 
+block_database::mapped_file_ptr block_database::map_range( const fc::path& file, mapped_file_ptr& cache,
+                                                          uint64_t end )const
+{
+   mapped_file_ptr current = std::atomic_load( &cache );
+   if( current && current->size() >= end )
+      return current;
+
+   std::lock_guard<std::mutex> guard( _map_mutex );
+   // somebody else may have grown the mapping while we were waiting
+   current = std::atomic_load( &cache );
+   if( current && current->size() >= end )
+      return current;
+
+   const uint64_t file_size = fc::file_size( file );
+   if( file_size < end )
+      return mapped_file_ptr();
+
+   // readers holding the old mapping keep it alive until they are done with it
+   current = std::make_shared<const mapped_file>( file, file_size );
+   std::atomic_store( &cache, current );
+   return current;
+}
+
+bool block_database::read_mapped_index_entry( uint32_t block_num, index_entry& e )const
+{
+   const uint64_t index_pos = uint64_t( sizeof(e) ) * block_num;
+   mapped_file_ptr index = map_range( _index_filename, _index_map, index_pos + sizeof(e) );
+   if( !index )
+      return false;
+   std::memcpy( (char*)&e, index->data() + index_pos, sizeof(e) );
+   return true;
+}
+
+optional<signed_block> block_database::unpack_mapped_block( const index_entry& e )const
+{
+   if( e.block_size == 0 )
+      return optional<signed_block>();
+
+   mapped_file_ptr blocks = map_range( _blocks_filename, _blocks_map, e.block_pos + e.block_size );
+   FC_ASSERT( blocks, "Block ${id} points past the end of the blocks file", ("id", e.block_id) );
+
+   fc::datastream<const char*> ds( blocks->data() + e.block_pos, e.block_size );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.id() == e.block_id );
+   return result;
+}
+
+void block_database::reset_mappings()const
+{
+   std::lock_guard<std::mutex> guard( _map_mutex );
+   std::atomic_store( &_index_map, mapped_file_ptr() );
+   std::atomic_store( &_blocks_map, mapped_file_ptr() );
+}
+
 } }
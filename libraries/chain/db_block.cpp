@@ -74,6 +74,14 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
    return b->data;
 }
 
+optional< vector<char> > database::fetch_packed_block_by_id( const block_id_type& id )const
+{
+   auto b = _fork_db.fetch_block( id );
+   if( !b )
+      return _block_id_to_block.fetch_packed(id);
+   return fc::raw::pack( b->data );
+}
+
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
@@ -84,12 +92,36 @@ optional<signed_block> database::fetch_block_by_number( uint32_t num )const
    return optional<signed_block>();
 }
 
-const signed_transaction& database::get_recent_transaction(const transaction_id_type& trx_id) const
+signed_transaction database::get_recent_transaction(const transaction_id_type& trx_id) const
 {
    auto& index = get_index_type<transaction_index>().indices().get<by_trx_id>();
    auto itr = index.find(trx_id);
    FC_ASSERT(itr != index.end());
-   return itr->trx;
+
+   if( itr->block_num > head_block_num() )
+   {
+      for( const processed_transaction& trx : _pending_tx )
+         if( trx.id() == trx_id )
+            return trx;
+   }
+   else
+   {
+      const auto find_in_block = [&trx_id]( const signed_block& block ) -> const signed_transaction* {
+         for( const processed_transaction& trx : block.transactions )
+            if( trx.id() == trx_id )
+               return &trx;
+         return nullptr;
+      };
+      // the block may be on a fork that is not in the block log yet
+      for( const auto& item : _fork_db.fetch_block_by_number( itr->block_num ) )
+         if( const signed_transaction* trx = find_in_block( item->data ) )
+            return *trx;
+      optional<signed_block> block = _block_id_to_block.fetch_by_number( itr->block_num );
+      if( block )
+         if( const signed_transaction* trx = find_in_block( *block ) )
+            return *trx;
+   }
+   FC_THROW( "Transaction ${id} is no longer available", ("id",trx_id) );
 }
 
 std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of_fork) const
@@ -119,6 +151,9 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   if( !(skip & (skip_transaction_signatures | skip_authority_check)) && !before_last_checkpoint() )
+      precompute_signature_keys( new_block );
+
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -131,6 +166,22 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
    return result;
 }
 
+void database::precompute_signature_keys( const signed_block& block )const
+{
+   if( !_signature_recovery_pool || block.transactions.size() < 2 )
+      return;
+
+   const chain_id_type& chain_id = get_chain_id();
+   const auto& transactions = block.transactions;
+   _signature_recovery_pool->for_each_index( transactions.size(), [&chain_id,&transactions]( size_t i ) {
+      // signees is only assigned once all signatures have been recovered, so a transaction
+      // that fails here is left untouched and fails again, in order, in _apply_transaction
+      try {
+         transactions[i].get_signature_keys( chain_id );
+      } catch( const fc::exception& ) {}
+   }, "signature recovery" );
+}
+
 bool database::_push_block(const signed_block& new_block)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
@@ -376,6 +427,8 @@ processed_transaction database::push_proposal(const proposal_object& proposal)
       else
       {
          _applied_ops.resize( old_applied_ops_size );
+         if( _applied_ops_impacted.size() > old_applied_ops_size )
+            _applied_ops_impacted.resize( old_applied_ops_size );
       }
       edump((e));
       throw;
@@ -438,10 +491,17 @@ signed_block database::_generate_block(
    _pending_tx_session.reset();
    _pending_tx_session = _undo_db.start_undo_session();
 
+   const fc::time_point rebuild_start = fc::time_point::now();
    uint64_t postponed_tx_count = 0;
    // pop pending state (reset to head block state)
    for( const processed_transaction& tx : _pending_tx )
    {
+      if( is_expired_pending_transaction( tx ) )
+      {
+         ++_pending_tx_stats.dropped;
+         continue;
+      }
+
       size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
       // postpone transaction if it would make block too big
@@ -462,10 +522,12 @@ signed_block database::_generate_block(
          // their size)
          total_block_size += fc::raw::pack_size( ptx );
          pending_block.transactions.push_back( ptx );
+         ++_pending_tx_stats.reapplied;
       }
       catch ( const fc::exception& e )
       {
          // Do nothing, transaction will not be re-applied
+         ++_pending_tx_stats.dropped;
          wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
          wlog( "The transaction was ${t}", ("t", tx) );
       }
@@ -474,6 +536,7 @@ signed_block database::_generate_block(
    {
       wlog( "Postponed ${n} transactions due to block size limit", ("n", postponed_tx_count) );
    }
+   record_pending_rebuild( fc::time_point::now() - rebuild_start );
 
    _pending_tx_session.reset();
 
@@ -535,6 +598,52 @@ void database::pop_block()
 
 } FC_CAPTURE_AND_RETHROW() }
 
+bool database::is_expired_pending_transaction( const signed_transaction& trx )const
+{
+   // the same check _apply_transaction() makes, expiration only moves closer as the head block time advances
+   return head_block_num() > 0 && head_block_time() > trx.expiration;
+}
+
+bool database::reapply_pending_transaction( const signed_transaction& trx )
+{
+   try
+   {
+      if( is_known_transaction( trx.id() ) )
+         return false;
+      if( is_expired_pending_transaction( trx ) )
+      {
+         ++_pending_tx_stats.dropped;
+         return false;
+      }
+      _push_transaction( trx );
+      ++_pending_tx_stats.reapplied;
+      return true;
+   }
+   catch( const fc::exception& e )
+   {
+      ++_pending_tx_stats.dropped;
+      /*
+      wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", head_block_id())("t",head_block_time()) );
+      wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
+      */
+   }
+   return false;
+}
+
+void database::record_pending_rebuild( fc::microseconds elapsed )
+{
+   ++_pending_tx_stats.rebuilds;
+   _pending_tx_stats.last_rebuild_time = elapsed;
+   _pending_tx_stats.total_rebuild_time += elapsed;
+}
+
+pending_transactions_stats database::get_pending_transactions_stats()const
+{
+   pending_transactions_stats result = _pending_tx_stats;
+   result.pending_count = _pending_tx.size();
+   return result;
+}
+
 void database::clear_pending()
 { try {
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
@@ -572,6 +681,35 @@ vector<optional< operation_history_object > >& database::get_applied_operations(
 {
    return _applied_ops;
 }
+
+const flat_set<account_id_type>& database::get_applied_operation_impacted_accounts( size_t op_index )const
+{
+   FC_ASSERT( op_index < _applied_ops.size() );
+   if( _applied_ops_impacted.size() < _applied_ops.size() )
+      _applied_ops_impacted.resize( _applied_ops.size() );
+
+   optional<flat_set<account_id_type>>& impacted = _applied_ops_impacted[op_index];
+   if( !impacted.valid() )
+   {
+      impacted = flat_set<account_id_type>();
+      const optional<operation_history_object>& op = _applied_ops[op_index];
+      if( op.valid() )
+      {
+         vector<authority> other;
+         operation_get_required_authorities( op->op, *impacted, *impacted, other ); // fee_payer is added here
+
+         if( op->op.which() == operation::tag< account_create_operation >::value )
+            impacted->insert( op->result.get<object_id_type>() );
+         else
+            operation_get_impacted_accounts( op->op, *impacted );
+
+         for( auto& a : other )
+            for( auto& item : a.account_auths )
+               impacted->insert( item.first );
+      }
+   }
+   return *impacted;
+}
 //////////////////// private methods ////////////////////
 
 void database::apply_block( const signed_block& next_block, uint32_t skip )
@@ -599,6 +737,7 @@ void database::_apply_block( const signed_block& next_block )
    uint32_t next_block_num = next_block.block_num();
    uint32_t skip = get_node_properties().skip_flags;
    _applied_ops.clear();
+   _applied_ops_impacted.clear();
 
    FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root(), "", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",next_block.calculate_merkle_root())("next_block",next_block)("id",next_block.id()) );
 
@@ -672,6 +811,7 @@ void database::_apply_block( const signed_block& next_block )
    // notify observers that the block has been applied
    notify_applied_block( next_block ); //emit
    _applied_ops.clear();
+   _applied_ops_impacted.clear();
 
    notify_changed_objects();
 } FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
@@ -751,9 +891,11 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    //Insert transaction into unique transactions database.
    if( !(skip & skip_transaction_dupe_check) )
    {
-      create<transaction_object>([&trx_id,&trx](transaction_object& transaction) {
+      const uint32_t block_num = head_block_num() + 1;
+      create<transaction_object>([&trx_id,&trx,block_num](transaction_object& transaction) {
          transaction.trx_id = trx_id;
-         transaction.trx = trx;
+         transaction.expiration = trx.expiration;
+         transaction.block_num = block_num;
       });
    }
 
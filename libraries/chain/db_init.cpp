@@ -277,12 +277,14 @@ void database::initialize_indexes()
    add_index< primary_index<betting_market_rules_object_index > >();
    add_index< primary_index<betting_market_group_object_index > >();
    add_index< primary_index<betting_market_object_index > >();
-   add_index< primary_index<bet_object_index > >();
+   auto bet_idx = add_index< primary_index<bet_object_index > >();
+   bet_idx->add_secondary_index<bet_price_level_index>();
 
    add_index< primary_index<tournament_index> >();
    auto tournament_details_idx = add_index< primary_index<tournament_details_index> >();
    tournament_details_idx->add_secondary_index<tournament_players_index>();
-   add_index< primary_index<match_index> >();
+   auto match_idx = add_index< primary_index<match_index> >();
+   match_idx->add_secondary_index<tournament_progress_index>();
    add_index< primary_index<game_index> >();
 
    //Implementation object indexes
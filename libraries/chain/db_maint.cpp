@@ -77,7 +77,7 @@ vector<std::reference_wrapper<const typename Index::object_type>> database::sort
 }
 
 template<class Type>
-void database::perform_account_maintenance(Type tally_helper)
+void database::perform_account_maintenance(Type& tally_helper)
 {
    const auto& bal_idx = get_index_type< account_balance_index >().indices().get< by_maintenance_flag >();
    if( bal_idx.begin() != bal_idx.end() )
@@ -878,7 +878,7 @@ double database::calculate_vesting_factor(const account_object& stake_account)
    return vesting_factor;
 }
 
-share_type credit_account(database& db, const account_id_type owner_id, const std::string owner_name,
+share_type credit_account(database& db, const account_id_type owner_id,
                           share_type remaining_amount_to_distribute,
                           const share_type shares_to_credit, const asset_id_type payout_asset_type,
                           const pending_dividend_payout_balance_for_holder_object_index& pending_payout_balance_index,
@@ -890,7 +890,7 @@ share_type credit_account(database& db, const account_id_type owner_id, const st
       remaining_amount_to_distribute -= shares_to_credit;
 
       dlog("Crediting account ${account} with ${amount}",
-           ("account", owner_name)
+           ("account", owner_id)
                  ("amount", asset(shares_to_credit, payout_asset_type)));
       auto pending_payout_iter =
             pending_payout_balance_index.indices().get<by_dividend_payout_account>().find(
@@ -948,7 +948,8 @@ void schedule_pending_dividend_balances(database& db,
 { try {
    dlog("Processing dividend payments for dividend holder asset type ${holder_asset} at time ${t}",
         ("holder_asset", dividend_holder_asset_obj.symbol)("t", db.head_block_time()));
-   auto balance_by_acc_index = db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< balances_by_account_index >();
+   const auto& balance_by_acc_index = db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< balances_by_account_index >();
+   // copy the distribution account's balances, the loop below adjusts them
    auto current_distribution_account_balance_range = 
       //balance_index.indices().get<by_account_asset>().equal_range(boost::make_tuple(dividend_data.dividend_distribution_account));
       balance_by_acc_index.get_account_balances(dividend_data.dividend_distribution_account);
@@ -986,9 +987,6 @@ void schedule_pending_dividend_balances(database& db,
    {
         vesting_amounts[vesting_balance_obj.owner] += vesting_balance_obj.balance.amount;
         ++holder_account_count;
-        dlog("Vesting balance for account: ${owner}, amount: ${amount}",
-             ("owner", vesting_balance_obj.owner(db).name)
-             ("amount", vesting_balance_obj.balance.amount));
    }
 #else
    // get only once a collection of accounts that hold nonzero vesting balances of the dividend asset
@@ -1040,6 +1038,18 @@ void schedule_pending_dividend_balances(database& db,
                total_balance_of_dividend_asset += itr->second;
          }
    }
+   // The vesting factor of a holder does not change while dividends are scheduled, so it is
+   // computed once per holder rather than once per holder and payout asset
+   vector<double> vesting_factors;
+   auto get_vesting_factors = [&]() -> const vector<double>& {
+      if (vesting_factors.empty())
+         for (const vesting_balance_object &holder_balance_object : boost::make_iterator_range(vesting_balances_begin,
+                                                                                               vesting_balances_end))
+            vesting_factors.push_back(holder_balance_object.owner == dividend_data.dividend_distribution_account ? 0
+                                      : db.calculate_vesting_factor(holder_balance_object.owner(db)));
+      return vesting_factors;
+   };
+
    // loop through all of the assets currently or previously held in the distribution account
    while (current_distribution_account_balance_iter != current_distribution_account_balance_range.end() ||
           previous_distribution_account_balance_iter != previous_distribution_account_balance_range.second)
@@ -1165,12 +1175,13 @@ void schedule_pending_dividend_balances(database& db,
 
                if(db.head_block_time() >= HARDFORK_GPOS_TIME && dividend_holder_asset_obj.symbol == GRAPHENE_SYMBOL) { // core only
                   // credit each account with their portion, don't send any back to the dividend distribution account
+                  const vector<double>& holder_vesting_factors = get_vesting_factors();
+                  auto vesting_factor_iter = holder_vesting_factors.begin();
                   for (const vesting_balance_object &holder_balance_object : boost::make_iterator_range(
                         vesting_balances_begin, vesting_balances_end)) {
+                     const double vesting_factor = *vesting_factor_iter++;
                      if (holder_balance_object.owner == dividend_data.dividend_distribution_account) continue;
 
-                     auto vesting_factor = db.calculate_vesting_factor(holder_balance_object.owner(db));
-
                      auto holder_balance = holder_balance_object.balance;
 
                      fc::uint128_t amount_to_credit(delta_balance.value);
@@ -1190,7 +1201,6 @@ void schedule_pending_dividend_balances(database& db,
 
                      remaining_amount_to_distribute = credit_account(db,
                                                                      holder_balance_object.owner,
-                                                                     holder_balance_object.owner(db).name,
                                                                      remaining_amount_to_distribute,
                                                                      shares_to_credit,
                                                                      payout_asset_type,
@@ -1217,7 +1227,6 @@ void schedule_pending_dividend_balances(database& db,
 
                      remaining_amount_to_distribute = credit_account(db,
                                                                      holder_balance_object.owner,
-                                                                     holder_balance_object.owner(db).name,
                                                                      remaining_amount_to_distribute,
                                                                      shares_to_credit,
                                                                      payout_asset_type,
@@ -1225,11 +1234,6 @@ void schedule_pending_dividend_balances(database& db,
                                                                      dividend_holder_asset_obj.id);
                   }
                }
-               for (const auto& pending_payout : pending_payout_balance_index.indices())
-                  if (pending_payout.pending_balance.value)
-                      dlog("Pending payout: ${account_name}   ->   ${amount}",
-                           ("account_name", pending_payout.owner(db).name)
-                           ("amount", asset(pending_payout.pending_balance, pending_payout.dividend_payout_asset_type)));
                dlog("Remaining balance not paid out: ${amount}", 
                     ("amount", asset(remaining_amount_to_distribute, payout_asset_type)));
 
@@ -1492,7 +1496,19 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
    struct vote_tally_helper {
       database& d;
       const global_property_object& props;
-      std::map<account_id_type, share_type> vesting_amounts;
+      /// summed GPOS vesting balances, indexed by account instance
+      vector<share_type> vesting_amounts;
+      vector<bool> has_vesting_amount;
+      /// accounts whose votes are counted after the account walk, in parallel
+      bool defer_tally = false;
+      vector<const account_object*> deferred_accounts;
+
+      struct tally_buffers {
+         vector<uint64_t>& votes;
+         vector<uint64_t>& witness_counts;
+         vector<uint64_t>& committee_counts;
+         uint64_t&         total_voting_stake;
+      };
 
       vote_tally_helper(database& d, const global_property_object& gpo)
          : d(d), props(gpo)
@@ -1506,6 +1522,15 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
          if(d.head_block_time() >= HARDFORK_GPOS_TIME)
             balance_type = vesting_balance_type::gpos;
 
+         const auto account_count = d.get_index<account_object>().get_next_id().instance();
+         vesting_amounts.resize(account_count);
+         has_vesting_amount.resize(account_count);
+         auto add_vesting_amount = [&]( const vesting_balance_object& vesting_balance_obj ) {
+            const auto instance = vesting_balance_obj.owner.instance.value;
+            vesting_amounts[instance] += vesting_balance_obj.balance.amount;
+            has_vesting_amount[instance] = true;
+         };
+
          const vesting_balance_index& vesting_index = d.get_index_type<vesting_balance_index>();
 #ifdef USE_VESTING_OBJECT_BY_ASSET_BALANCE_INDEX
          auto vesting_balances_begin =
@@ -1513,111 +1538,152 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
          auto vesting_balances_end =
               vesting_index.indices().get<by_asset_balance>().upper_bound(boost::make_tuple(asset_id_type(), balance_type, share_type()));
          for (const vesting_balance_object& vesting_balance_obj : boost::make_iterator_range(vesting_balances_begin, vesting_balances_end))
-         {
-            vesting_amounts[vesting_balance_obj.owner] += vesting_balance_obj.balance.amount;
-            dlog("Vesting balance for account: ${owner}, amount: ${amount}",
-                 ("owner", vesting_balance_obj.owner(d).name)
-                 ("amount", vesting_balance_obj.balance.amount));
-         }
+            add_vesting_amount(vesting_balance_obj);
 #else
          const auto& vesting_balances = vesting_index.indices().get<by_id>();
          for (const vesting_balance_object& vesting_balance_obj : vesting_balances)
          {
             if (vesting_balance_obj.balance.asset_id == asset_id_type() && vesting_balance_obj.balance.amount && vesting_balance_obj.balance_type == balance_type)
-            {
-                vesting_amounts[vesting_balance_obj.owner] += vesting_balance_obj.balance.amount;
-                dlog("Vesting balance for account: ${owner}, amount: ${amount}",
-                     ("owner", vesting_balance_obj.owner(d).name)
-                     ("amount", vesting_balance_obj.balance.amount));
-            }
+               add_vesting_amount(vesting_balance_obj);
          }
 #endif
+
+         // Once the GPOS transition is over, the voting stake of an account only depends on its GPOS vesting
+         // balances, summed above, and on its voting options and history, none of which are touched by the fee
+         // processing that the account walk interleaves with the tally.  Counting the votes after the walk
+         // therefore gives exactly the same result.
+         defer_tally = d._vote_tally_pool
+                       && d.head_block_time() >= (HARDFORK_GPOS_TIME + props.parameters.gpos_subperiod()/2);
       }
 
       void operator()( const account_object& stake_account, const account_statistics_object& stats )
       {
          if( props.parameters.count_non_member_votes || stake_account.is_member(d.head_block_time()) )
          {
-            // There may be a difference between the account whose stake is voting and the one specifying opinions.
-            // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
-            // specifying the opinions.
-            const account_object* opinion_account_ptr =
-                  (stake_account.options.voting_account ==
-                   GRAPHENE_PROXY_TO_SELF_ACCOUNT)? &stake_account
-                                     : d.find(stake_account.options.voting_account);
-
-            if( !opinion_account_ptr ) // skip non-exist account
-               return;
+            if( defer_tally )
+               deferred_accounts.push_back( &stake_account );
+            else
+               tally( stake_account, tally_buffers{ d._vote_tally_buffer, d._witness_count_histogram_buffer,
+                                                    d._committee_count_histogram_buffer, d._total_voting_stake } );
+         }
+      }
 
-            const account_object& opinion_account = *opinion_account_ptr;
+      void tally( const account_object& stake_account, const tally_buffers& buffers )
+      {
+         // There may be a difference between the account whose stake is voting and the one specifying opinions.
+         // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
+         // specifying the opinions.
+         const account_object* opinion_account_ptr =
+               (stake_account.options.voting_account ==
+                GRAPHENE_PROXY_TO_SELF_ACCOUNT)? &stake_account
+                                  : d.find(stake_account.options.voting_account);
+
+         if( !opinion_account_ptr ) // skip non-exist account
+            return;
 
-            const auto& stats = stake_account.statistics(d);
-            uint64_t voting_stake = 0;
+         const account_object& opinion_account = *opinion_account_ptr;
 
-            auto itr = vesting_amounts.find(stake_account.id);
-            if (itr != vesting_amounts.end())
-                voting_stake += itr->second.value;
+         const auto& stats = stake_account.statistics(d);
+         uint64_t voting_stake = 0;
 
-            if(d.head_block_time() >= HARDFORK_GPOS_TIME)
-            {
-               if (itr == vesting_amounts.end() && d.head_block_time() >= (HARDFORK_GPOS_TIME + props.parameters.gpos_subperiod()/2))
-                  return;
+         const auto instance = stake_account.id.instance();
+         const bool has_vesting = instance < has_vesting_amount.size() && has_vesting_amount[instance];
+         if (has_vesting)
+             voting_stake += vesting_amounts[instance].value;
 
-               auto vesting_factor = d.calculate_vesting_factor(stake_account);
-               voting_stake = (uint64_t)floor(voting_stake * vesting_factor);
+         if(d.head_block_time() >= HARDFORK_GPOS_TIME)
+         {
+            if (!has_vesting && d.head_block_time() >= (HARDFORK_GPOS_TIME + props.parameters.gpos_subperiod()/2))
+               return;
 
-               //Include votes(based on stake) for the period of gpos_subperiod()/2 as system has zero votes on GPOS activation
-               if(d.head_block_time() < (HARDFORK_GPOS_TIME + props.parameters.gpos_subperiod()/2))
-               {
-                  voting_stake += stats.total_core_in_orders.value
-                                 + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value : 0)
-                                 + d.get_balance(stake_account.get_id(), asset_id_type()).amount.value;
-               }
-            }
-            else
+            auto vesting_factor = d.calculate_vesting_factor(stake_account);
+            voting_stake = (uint64_t)floor(voting_stake * vesting_factor);
+
+            //Include votes(based on stake) for the period of gpos_subperiod()/2 as system has zero votes on GPOS activation
+            if(d.head_block_time() < (HARDFORK_GPOS_TIME + props.parameters.gpos_subperiod()/2))
             {
                voting_stake += stats.total_core_in_orders.value
-                               + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value : 0)
-                               + d.get_balance(stake_account.get_id(), asset_id_type()).amount.value;
+                              + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value : 0)
+                              + d.get_balance(stake_account.get_id(), asset_id_type()).amount.value;
             }
+         }
+         else
+         {
+            voting_stake += stats.total_core_in_orders.value
+                            + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value : 0)
+                            + d.get_balance(stake_account.get_id(), asset_id_type()).amount.value;
+         }
 
-            for( vote_id_type id : opinion_account.options.votes )
-            {
-               uint32_t offset = id.instance();
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake;
-            }
+         for( vote_id_type id : opinion_account.options.votes )
+         {
+            uint32_t offset = id.instance();
+            // if they somehow managed to specify an illegal offset, ignore it.
+            if( offset < buffers.votes.size() )
+               buffers.votes[offset] += voting_stake;
+         }
 
-            if( opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
-            {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_witness/2),
-                                          d._witness_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_witness_count
-               // are turned into votes for maximum_witness_count.
-               //
-               // in particular, this takes care of the case where a
-               // member was voting for a high number, then the
-               // parameter was lowered.
-               d._witness_count_histogram_buffer[offset] += voting_stake;
-            }
-            if( opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
-            {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_committee/2),
-                                          d._committee_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_committee_count
-               // are turned into votes for maximum_committee_count.
-               //
-               // same rationale as for witnesses
-               d._committee_count_histogram_buffer[offset] += voting_stake;
-            }
+         if( opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_witness/2),
+                                       buffers.witness_counts.size() - 1);
+            // votes for a number greater than maximum_witness_count
+            // are turned into votes for maximum_witness_count.
+            //
+            // in particular, this takes care of the case where a
+            // member was voting for a high number, then the
+            // parameter was lowered.
+            buffers.witness_counts[offset] += voting_stake;
+         }
+         if( opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_committee/2),
+                                       buffers.committee_counts.size() - 1);
+            // votes for a number greater than maximum_committee_count
+            // are turned into votes for maximum_committee_count.
+            //
+            // same rationale as for witnesses
+            buffers.committee_counts[offset] += voting_stake;
+         }
 
-            d._total_voting_stake += voting_stake;
+         buffers.total_voting_stake += voting_stake;
+      }
+
+      /// counts the deferred accounts in shards, each into its own buffers, then adds the shards up in order
+      void tally_deferred()
+      {
+         if( deferred_accounts.empty() )
+            return;
+
+         const size_t shard_count = std::min<size_t>( d._vote_tally_pool->size(), deferred_accounts.size() );
+         vector< vector<uint64_t> > votes( shard_count, vector<uint64_t>( d._vote_tally_buffer.size() ) );
+         vector< vector<uint64_t> > witness_counts( shard_count, vector<uint64_t>( d._witness_count_histogram_buffer.size() ) );
+         vector< vector<uint64_t> > committee_counts( shard_count, vector<uint64_t>( d._committee_count_histogram_buffer.size() ) );
+         vector<uint64_t> total_voting_stake( shard_count );
+
+         d._vote_tally_pool->for_each_index( shard_count, [&]( size_t shard ) {
+            const tally_buffers buffers{ votes[shard], witness_counts[shard], committee_counts[shard], total_voting_stake[shard] };
+            const size_t end = deferred_accounts.size() * (shard + 1) / shard_count;
+            for( size_t i = deferred_accounts.size() * shard / shard_count; i < end; ++i )
+               tally( *deferred_accounts[i], buffers );
+         }, "vote tally" );
+
+         // unsigned addition commutes, so the sums are the same as those of the serial tally
+         auto merge = []( vector<uint64_t>& target, const vector<uint64_t>& shard ) {
+            for( size_t i = 0; i < target.size(); ++i )
+               target[i] += shard[i];
+         };
+         for( size_t shard = 0; shard < shard_count; ++shard )
+         {
+            merge( d._vote_tally_buffer, votes[shard] );
+            merge( d._witness_count_histogram_buffer, witness_counts[shard] );
+            merge( d._committee_count_histogram_buffer, committee_counts[shard] );
+            d._total_voting_stake += total_voting_stake[shard];
          }
       }
    } tally_helper(*this, gpo);
    
    perform_account_maintenance( tally_helper );
+   tally_helper.tally_deferred();
    struct clear_canary {
       clear_canary(vector<uint64_t>& target): target(target){}
       ~clear_canary() { target.clear(); }
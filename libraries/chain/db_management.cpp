@@ -30,11 +30,15 @@
 #include <graphene/chain/operation_history_object.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <graphene/db/thread_pool.hpp>
+
 #include <fc/io/fstream.hpp>
 
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory>
 
 namespace graphene { namespace chain {
 
@@ -94,6 +98,144 @@ public:
     }
 };
 
+/**
+ * Result of the read/decode stage of a pipelined replay.  Everything in here is
+ * computed on a worker thread, the apply thread only consumes it.
+ */
+struct prefetched_block
+{
+   fc::optional<signed_block> block;
+   /// whether the transaction merkle root in the header has already been verified
+   bool                       merkle_root_checked = false;
+   uint32_t                   op_count = 0;
+};
+
+/**
+ * Read/decode stage of a pipelined replay: keeps a window of blocks ahead of the
+ * apply thread being fetched, unpacked and pre-validated on a thread pool.
+ * Blocks are handed out strictly in order.
+ *
+ * Workers read the block log through its memory mapped read path, which is safe
+ * to use concurrently with the apply thread.
+ */
+class replay_block_prefetcher
+{
+   public:
+      replay_block_prefetcher( const block_database& blocks, uint32_t first_block, uint32_t last_block,
+                               uint32_t num_threads )
+         : _blocks( blocks ), _pool( num_threads, "replay" ), _next_block( first_block ),
+           _last_block( last_block ), _window( _pool.size() * 32 )
+      {
+         fill_window();
+      }
+
+      ~replay_block_prefetcher()
+      {
+         // workers reference the block log, do not leave them running behind us
+         for( auto& f : _window_results )
+         {
+            try {
+               f.wait();
+            } catch( ... ) {}
+         }
+      }
+
+      std::shared_ptr<prefetched_block> next()
+      {
+         FC_ASSERT( !_window_results.empty(), "Replay prefetcher ran past the last block" );
+         auto result = _window_results.front();
+         _window_results.pop_front();
+         fill_window();
+         return result.wait();
+      }
+
+   private:
+      void fill_window()
+      {
+         while( _window_results.size() < _window && _next_block <= _last_block )
+         {
+            const uint32_t block_num = _next_block++;
+            const block_database& blocks = _blocks;
+            _window_results.push_back( _pool.async( [&blocks,block_num]() {
+               return prefetch( blocks, block_num );
+            }, "replay prefetch" ) );
+         }
+      }
+
+      static std::shared_ptr<prefetched_block> prefetch( const block_database& blocks, uint32_t block_num )
+      {
+         auto result = std::make_shared<prefetched_block>();
+         result->block = blocks.fetch_by_number( block_num );
+         if( result->block.valid() )
+         {
+            result->merkle_root_checked = ( result->block->transaction_merkle_root
+                                            == result->block->calculate_merkle_root() );
+            for( const auto& trx : result->block->transactions )
+               result->op_count += trx.operations.size();
+         }
+         return result;
+      }
+
+      const block_database&                                         _blocks;
+      graphene::db::thread_pool                                     _pool;
+      uint32_t                                                      _next_block;
+      const uint32_t                                                _last_block;
+      const size_t                                                  _window;
+      std::deque< fc::future< std::shared_ptr<prefetched_block> > > _window_results;
+};
+
+/**
+ * Logs replay progress and throughput at most once every few seconds.
+ */
+class replay_progress_reporter
+{
+   public:
+      explicit replay_progress_reporter( uint32_t last_block )
+         : _last_block( last_block ), _start( fc::time_point::now() ), _last_report( _start ),
+           _blocks_since_report( 0 ), _ops_since_report( 0 ), _total_blocks( 0 ), _total_ops( 0 )
+      {
+      }
+
+      void block_applied( uint32_t block_num, uint32_t op_count )
+      {
+         ++_blocks_since_report;
+         _ops_since_report += op_count;
+         const fc::time_point now = fc::time_point::now();
+         if( now - _last_report < fc::seconds( 10 ) && block_num != _last_block )
+            return;
+
+         const double interval = double( (now - _last_report).count() ) / 1000000.0;
+         _total_blocks += _blocks_since_report;
+         _total_ops += _ops_since_report;
+         if( interval > 0 )
+            ilog( "Replayed block ${n} of ${last} (${p}%), ${bps} blocks/s, ${ops} ops/s",
+                  ("n", block_num)("last", _last_block)("p", double( block_num ) * 100 / _last_block)
+                  ("bps", uint64_t( _blocks_since_report / interval ))("ops", uint64_t( _ops_since_report / interval )) );
+         _last_report = now;
+         _blocks_since_report = 0;
+         _ops_since_report = 0;
+      }
+
+      void done()const
+      {
+         const double elapsed = double( (fc::time_point::now() - _start).count() ) / 1000000.0;
+         if( elapsed > 0 )
+            ilog( "Replayed ${b} blocks and ${o} operations, average ${bps} blocks/s, ${ops} ops/s",
+                  ("b", _total_blocks + _blocks_since_report)("o", _total_ops + _ops_since_report)
+                  ("bps", uint64_t( (_total_blocks + _blocks_since_report) / elapsed ))
+                  ("ops", uint64_t( (_total_ops + _ops_since_report) / elapsed )) );
+      }
+
+   private:
+      const uint32_t  _last_block;
+      fc::time_point  _start;
+      fc::time_point  _last_report;
+      uint64_t        _blocks_since_report;
+      uint64_t        _ops_since_report;
+      uint64_t        _total_blocks;
+      uint64_t        _total_ops;
+};
+
 void database::reindex( fc::path data_dir )
 { try {
    auto last_block = _block_id_to_block.last();
@@ -121,18 +263,44 @@ void database::reindex( fc::path data_dir )
    {
        undo.disable();
    }
+   // the pipelined replay reads the block log from worker threads, which is only safe
+   // through the memory mapped read path
+   const bool was_mmap = _block_id_to_block.mmap_reads_enabled();
+   std::unique_ptr<replay_block_prefetcher> prefetcher;
+   if( _replay_threads > 0 )
+   {
+      ilog( "Using ${n} threads to read and decode blocks", ("n", _replay_threads) );
+      _block_id_to_block.flush();
+      _block_id_to_block.enable_mmap_reads( true );
+      prefetcher.reset( new replay_block_prefetcher( _block_id_to_block, head_block_num() + 1, last_block_num,
+                                                     _replay_threads ) );
+   }
+
+   replay_progress_reporter progress( last_block_num );
    for( uint32_t i = head_block_num() + 1; i <= last_block_num; ++i )
    {
-      if( i % 10000 == 0 ) std::cerr << "   " << double(i*100)/last_block_num << "%   "<<i << " of " <<last_block_num<<"   \n";
       if( i == flush_point )
       {
          ilog( "Writing database to disk at block ${i}", ("i",i) );
          flush();
          ilog( "Done" );
       }
-      fc::optional< signed_block > block = _block_id_to_block.fetch_by_number(i);
+      std::shared_ptr<prefetched_block> prefetched;
+      if( prefetcher )
+         prefetched = prefetcher->next();
+      else
+      {
+         prefetched = std::make_shared<prefetched_block>();
+         prefetched->block = _block_id_to_block.fetch_by_number(i);
+         if( prefetched->block.valid() )
+            for( const auto& trx : prefetched->block->transactions )
+               prefetched->op_count += trx.operations.size();
+      }
+      const fc::optional< signed_block >& block = prefetched->block;
       if( !block.valid() )
       {
+         // stop reading ahead before we start cutting off the end of the block log
+         prefetcher.reset();
          wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
          uint32_t dropped_count = 0;
          while( true )
@@ -150,26 +318,27 @@ void database::reindex( fc::path data_dir )
          wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
          break;
       }
+      const uint32_t skip = skip_witness_signature |
+                            skip_transaction_signatures |
+                            skip_transaction_dupe_check |
+                            skip_tapos_check |
+                            skip_witness_schedule_check |
+                            skip_authority_check |
+                            ( prefetched->merkle_root_checked ? skip_merkle_check : 0 );
       if( i < undo_point && !_slow_replays)
       {
-         apply_block(*block, skip_witness_signature |
-                             skip_transaction_signatures |
-                             skip_transaction_dupe_check |
-                             skip_tapos_check |
-                             skip_witness_schedule_check |
-                             skip_authority_check);
+         apply_block(*block, skip);
       }
       else
       {
          undo.enable();
-         push_block(*block, skip_witness_signature |
-                            skip_transaction_signatures |
-                            skip_transaction_dupe_check |
-                            skip_tapos_check |
-                            skip_witness_schedule_check |
-                            skip_authority_check);
+         push_block(*block, skip);
       }
+      progress.block_applied( i, prefetched->op_count );
    }
+   prefetcher.reset();
+   _block_id_to_block.enable_mmap_reads( was_mmap );
+   progress.done();
    undo.enable();
    auto end = fc::time_point::now();
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
@@ -234,6 +403,14 @@ void database::open(
                     "last block ID does not match current chain state",
                     ("last_block->id", last_block)("head_block_id",head_block_num()) );
          reindex( data_dir );
+         // Blocks following the head block have to link to it, even when the block log holds nothing
+         // before it, as after bootstrapping from a snapshot.
+         if( !_fork_db.head() && head_block_num() > 0 )
+         {
+            const auto head_block = fetch_block_by_number( head_block_num() );
+            if( head_block.valid() && head_block->id() == head_block_id() )
+               _fork_db.start_block( *head_block );
+         }
       }
       _opened = true;
    }
@@ -291,19 +468,48 @@ void database::force_slow_replays()
    _slow_replays = true;
 }
 
+void database::set_signature_recovery_threads( uint32_t num_threads )
+{
+   if( num_threads > 0 )
+   {
+      ilog( "Using ${n} threads to recover transaction signatures", ("n", num_threads) );
+      _signature_recovery_pool.reset( new graphene::db::thread_pool( num_threads, "sigrecovery" ) );
+   }
+   else
+      _signature_recovery_pool.reset();
+}
+
+void database::set_vote_tally_threads( uint32_t num_threads )
+{
+   if( num_threads > 0 )
+   {
+      ilog( "Using ${n} threads to tally votes", ("n", num_threads) );
+      _vote_tally_pool.reset( new graphene::db::thread_pool( num_threads, "votetally" ) );
+   }
+   else
+      _vote_tally_pool.reset();
+}
+
 void database::check_ending_lotteries()
 {
+   // Only one lottery is ended per block: of the lotteries that are due, the one with the latest end date,
+   // the oldest one among those ending at the same time.  This is the order the chain has always ended them in.
+   // Lotteries without an end date, which only end when sold out, were never ended here.
+   const auto& lotteries_idx = get_index_type<asset_index>().indices().get<by_lottery_expiration>();
+   auto active_begin = lotteries_idx.lower_bound( boost::make_tuple( true, time_point_sec() + 1 ) );
+   auto due_end = lotteries_idx.upper_bound( boost::make_tuple( true, head_block_time() ) );
+   if( active_begin == due_end )
+      return;
+
+   const time_point_sec end_date = std::prev( due_end )->get_lottery_expiration();
+   const asset_object& lottery = *lotteries_idx.lower_bound( boost::make_tuple( true, end_date ) );
    try {
-      const auto& lotteries_idx = get_index_type<asset_index>().indices().get<active_lotteries>();      
-      for( auto checking_asset: lotteries_idx )
-      {
-         FC_ASSERT( checking_asset.is_lottery() );
-         FC_ASSERT( checking_asset.lottery_options->is_active );
-         FC_ASSERT( checking_asset.lottery_options->end_date != time_point_sec() );
-         if( checking_asset.lottery_options->end_date > head_block_time() ) continue;
-         checking_asset.end_lottery(*this);
-      }
-   } catch( ... ) {}
+      lottery.end_lottery( *this );
+   } catch( const fc::exception& e ) {
+      wlog( "Unable to end lottery ${id}: ${e}", ("id", lottery.id)("e", e.to_detail_string()) );
+   } catch( ... ) {
+      wlog( "Unable to end lottery ${id}", ("id", lottery.id) );
+   }
 }
 
 void database::check_lottery_end_by_participants( asset_id_type asset_id )
@@ -408,12 +408,10 @@ void get_relevant_accounts( const object* obj, flat_set<account_id_type>& accoun
               assert( aobj != nullptr );
               accounts.insert( aobj->owner );
               break;
-           } case impl_transaction_object_type:{
-              const auto& aobj = dynamic_cast<const transaction_object*>(obj);
-              assert( aobj != nullptr );
-              transaction_get_impacted_accounts( aobj->trx, accounts );
+           } case impl_transaction_object_type:
+              // only the id is kept, the accounts are notified through the objects the operations changed
               break;
-           } case impl_blinded_balance_object_type:{
+             case impl_blinded_balance_object_type:{
               const auto& aobj = dynamic_cast<const blinded_balance_object*>(obj);
               assert( aobj != nullptr );
               for( const auto& a : aobj->owner.account_auths )
@@ -457,18 +455,25 @@ void database::notify_changed_objects()
    {
       const auto& head_undo = _undo_db.head();
 
+      // The impacted accounts are only collected if a slot asks for them, see lazy_account_set
+
       // New
       if( !new_objects.empty() )
       {
-        vector<object_id_type> new_ids;  new_ids.reserve(head_undo.new_ids.size());
-        flat_set<account_id_type> new_accounts_impacted;
-        for( const auto& item : head_undo.new_ids )
+        vector<object_id_type> new_ids;  new_ids.reserve(head_undo.records.size());
+        head_undo.for_each( undo_record::created, [&]( const undo_record& item )
         {
-          new_ids.push_back(item);
-          auto obj = find_object(item);
-          if(obj != nullptr)
-            get_relevant_accounts(obj, new_accounts_impacted);
-        }
+          new_ids.push_back(item.id);
+        });
+        const lazy_account_set new_accounts_impacted( [this,&new_ids]( flat_set<account_id_type>& accounts )
+        {
+          for( const object_id_type& id : new_ids )
+          {
+            auto obj = find_object(id);
+            if(obj != nullptr)
+              get_relevant_accounts(obj, accounts);
+          }
+        });
 
         GRAPHENE_TRY_NOTIFY( new_objects, new_ids, new_accounts_impacted)
       }
@@ -476,13 +481,18 @@ void database::notify_changed_objects()
       // Changed
       if( !changed_objects.empty() )
       {
-        vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-        flat_set<account_id_type> changed_accounts_impacted;
-        for( const auto& item : head_undo.old_values )
+        vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.records.size());
+        head_undo.for_each( undo_record::modified, [&]( const undo_record& item )
         {
-          changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted);
-        }
+          changed_ids.push_back(item.id);
+        });
+        const lazy_account_set changed_accounts_impacted( [&head_undo]( flat_set<account_id_type>& accounts )
+        {
+          head_undo.for_each( undo_record::modified, [&]( const undo_record& item )
+          {
+            get_relevant_accounts(item.snapshot, accounts);
+          });
+        });
 
         GRAPHENE_TRY_NOTIFY( changed_objects, changed_ids, changed_accounts_impacted)
       }
@@ -490,16 +500,18 @@ void database::notify_changed_objects()
       // Removed
       if( !removed_objects.empty() )
       {
-        vector<object_id_type> removed_ids; removed_ids.reserve( head_undo.removed.size() );
-        vector<const object*> removed; removed.reserve( head_undo.removed.size() );
-        flat_set<account_id_type> removed_accounts_impacted;
-        for( const auto& item : head_undo.removed )
+        vector<object_id_type> removed_ids; removed_ids.reserve( head_undo.records.size() );
+        vector<const object*> removed; removed.reserve( head_undo.records.size() );
+        head_undo.for_each( undo_record::removed, [&]( const undo_record& item )
         {
-          removed_ids.emplace_back( item.first );
-          auto obj = item.second.get();
-          removed.emplace_back( obj );
-          get_relevant_accounts(obj, removed_accounts_impacted);
-        }
+          removed_ids.emplace_back( item.id );
+          removed.emplace_back( item.snapshot );
+        });
+        const lazy_account_set removed_accounts_impacted( [&removed]( flat_set<account_id_type>& accounts )
+        {
+          for( const object* obj : removed )
+            get_relevant_accounts(obj, accounts);
+        });
 
         GRAPHENE_TRY_NOTIFY( removed_objects, removed_ids, removed, removed_accounts_impacted)
       }
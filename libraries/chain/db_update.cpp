@@ -34,6 +34,7 @@
 #include <graphene/chain/withdraw_permission_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/tournament_object.hpp>
+#include <graphene/chain/match_object.hpp>
 #include <graphene/chain/game_object.hpp>
 #include <graphene/chain/betting_market_object.hpp>
 
@@ -157,7 +158,7 @@ void database::clear_expired_transactions()
    //Transactions must have expired by at least two forking windows in order to be removed.
    auto& transaction_idx = static_cast<transaction_index&>(get_mutable_index(implementation_ids, impl_transaction_object_type));
    const auto& dedupe_index = transaction_idx.indices().get<by_expiration>();
-   while( (!dedupe_index.empty()) && (head_block_time() > dedupe_index.begin()->trx.expiration) )
+   while( (!dedupe_index.empty()) && (head_block_time() > dedupe_index.begin()->expiration) )
       transaction_idx.remove(*dedupe_index.begin());
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -582,17 +583,18 @@ void process_finished_matches(database& db)
 {
 }
 
-void process_in_progress_tournaments(database& db)
+void process_in_progress_tournaments(database& db, tournament_progress_index& progress)
 {
-   auto& start_time_index = db.get_index_type<tournament_index>().indices().get<by_start_time>();
-   auto start_iter = start_time_index.lower_bound(boost::make_tuple(tournament_state::in_progress));
-   while (start_iter != start_time_index.end() &&
-          start_iter->get_state() == tournament_state::in_progress)
+   // Only a tournament whose matches changed since it was last looked at can have new matches to start
+   for (const tournament_id_type& tournament_id : progress.take_changed_tournaments())
    {
-      auto next_iter = std::next(start_iter);
-      start_iter->check_for_new_matches_to_start(db);
-      start_iter = next_iter;
+      const tournament_object* tournament = db.find(tournament_id);
+      if (tournament && tournament->get_state() == tournament_state::in_progress)
+         tournament->check_for_new_matches_to_start(db);
    }
+   // starting matches doesn't change the outcome of the check above, so there is
+   // no need to look at the tournaments touched by it again
+   progress.clear_changed_tournaments();
 }
 
 void cancel_expired_tournaments(database& db)
@@ -675,7 +677,8 @@ void database::update_tournaments()
    process_finished_matches(*this);
    cancel_expired_tournaments(*this);
    start_fully_registered_tournaments(*this);
-   process_in_progress_tournaments(*this);
+   auto& match_idx = get_mutable_index_type< primary_index<match_index> >();
+   process_in_progress_tournaments(*this, match_idx.get_secondary_index<tournament_progress_index>());
    initiate_next_round_of_matches(*this);
    initiate_next_games(*this);
 }
@@ -325,6 +325,7 @@ namespace graphene { namespace chain {
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual bool is_isolated()const override { return true; }
 
 
          /** given an account or key, map it to the set of accounts that reference it in an active or owner authority */
@@ -356,6 +357,7 @@ namespace graphene { namespace chain {
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual bool is_isolated()const override { return true; }
 
          /** maps the referrer to the set of accounts that they have referred */
          map< account_id_type, set<account_id_type> > referred_by;
@@ -397,6 +399,7 @@ namespace graphene { namespace chain {
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual bool is_isolated()const override { return true; }
 
          const map< asset_id_type, const account_balance_object* >& get_account_balances( const account_id_type& acct )const;
          const account_balance_object* get_account_balance( const account_id_type& acct, const asset_id_type& asset )const;
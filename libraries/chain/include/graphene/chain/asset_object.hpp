@@ -91,6 +91,8 @@ namespace graphene { namespace chain {
          bool is_market_issued()const { return bitasset_data_id.valid(); }
          /// @return true if this is lottery asset; false otherwise.
          bool is_lottery()const { return lottery_options.valid(); }
+         /// @return true if this is a lottery asset that has not ended yet; false otherwise.
+         bool is_active_lottery()const { return is_lottery() && lottery_options->is_active; }
          /// @return true if users may request force-settlement of this market-issued asset; false otherwise
          bool can_force_settle()const { return !(options.flags & disable_force_settle); }
          /// @return true if the issuer of this market-issued asset may globally settle the asset; false otherwise
@@ -315,6 +317,7 @@ namespace graphene { namespace chain {
    struct active_lotteries;
    struct by_lottery;
    struct by_lottery_owner;
+   struct by_lottery_expiration;
    typedef multi_index_container<
       asset_object,
       indexed_by<
@@ -349,6 +352,14 @@ namespace graphene { namespace chain {
                std::greater< object_id_type >
             >
          >,
+         ordered_unique< tag<by_lottery_expiration>,
+            composite_key<
+               asset_object,
+               const_mem_fun<asset_object, bool, &asset_object::is_active_lottery>,
+               const_mem_fun<asset_object, time_point_sec, &asset_object::get_lottery_expiration>,
+               member<object, object_id_type, &object::id>
+            >
+         >,
          ordered_unique< tag<by_type>,
             composite_key< asset_object,
                 const_mem_fun<asset_object, bool, &asset_object::is_market_issued>,
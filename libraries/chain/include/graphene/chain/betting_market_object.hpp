@@ -606,6 +606,41 @@ typedef multi_index_container<
       ordered_unique< tag<by_bettor_and_odds>, identity<bet_object>, compare_bet_by_bettor_then_odds > > > bet_object_multi_index_type;
 typedef generic_index<bet_object, bet_object_multi_index_type> bet_object_index;
 
+/**
+ *  @brief Aggregates the bets of each betting market into price levels
+ *
+ *  A level sums up the unmatched amounts of all bets on one side of a betting market at one
+ *  backer_multiplier.  Delayed bets are not part of the order book yet and are only counted once
+ *  their delay has ended, so walking the levels gives the same book as walking the by_odds index,
+ *  with one step per odds instead of one per bet.
+ */
+class bet_price_level_index : public secondary_index
+{
+   public:
+      struct price_level
+      {
+         share_type amount_to_bet;
+         uint32_t   bet_count = 0;
+      };
+      /// levels of one side of a betting market by increasing backer_multiplier
+      typedef std::map<bet_multiplier_type, price_level> side_levels;
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after  ) override;
+      virtual bool is_isolated()const override { return true; }
+
+      /// @return the levels of one side of a betting market, nullptr if there are no bets on that side
+      const side_levels* get_levels( betting_market_id_type betting_market_id, bet_type back_or_lay )const;
+
+   private:
+      void add( const bet_object& bet );
+      void subtract( const bet_object& bet );
+
+      std::map< std::pair<betting_market_id_type, bet_type>, side_levels > _levels;
+};
+
 struct by_bettor_betting_market{};
 struct by_betting_market_bettor{};
 typedef multi_index_container<
@@ -23,9 +23,12 @@
  */
 #pragma once
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <graphene/chain/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 
 namespace graphene { namespace chain {
    class index_entry;
@@ -45,12 +48,52 @@ namespace graphene { namespace chain {
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /** @return the block exactly as stored, i.e. fc::raw packed, without unpacking it */
+         optional< vector<char> > fetch_packed( const block_id_type& id )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
+
+         /**
+          *  When enabled, lookups are served from read-only memory mappings of the
+          *  index and blocks files instead of the shared fstreams.  Readers do not
+          *  touch any stream state, so they can run concurrently with each other and
+          *  with store(), and blocks are unpacked directly from the mapped pages.
+          *  The mappings are grown lazily whenever a lookup reaches past their end.
+          *
+          *  Should be set before open().
+          */
+         void enable_mmap_reads( bool enable ) { _use_mmap = enable; }
+         bool mmap_reads_enabled()const { return _use_mmap; }
       private:
+         /** a read-only mapping of a whole file as it was at the time of mapping */
+         struct mapped_file
+         {
+            mapped_file( const fc::path& file, uint64_t size );
+
+            const char* data()const { return static_cast<const char*>( region.get_address() ); }
+            uint64_t    size()const { return region.get_size(); }
+
+            fc::file_mapping  mapping;
+            fc::mapped_region region;
+         };
+         typedef std::shared_ptr<const mapped_file> mapped_file_ptr;
+
          optional<index_entry> last_index_entry()const;
+
+         mapped_file_ptr map_range( const fc::path& file, mapped_file_ptr& cache, uint64_t end )const;
+         bool read_mapped_index_entry( uint32_t block_num, index_entry& e )const;
+         optional<signed_block> unpack_mapped_block( const index_entry& e )const;
+         void reset_mappings()const;
+
          fc::path _index_filename;
+         fc::path _blocks_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+
+         bool                    _use_mmap = false;
+         /// only taken to replace a mapping, readers access the mappings with atomic loads
+         mutable std::mutex      _map_mutex;
+         mutable mapped_file_ptr _index_map;
+         mutable mapped_file_ptr _blocks_map;
    };
 } }
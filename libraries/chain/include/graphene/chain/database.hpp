@@ -30,10 +30,12 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/impacted.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
 #include <graphene/db/simple_index.hpp>
+#include <graphene/db/thread_pool.hpp>
 #include <fc/signals.hpp>
 
 #include <fc/crypto/hash_ctr_rng.hpp>
@@ -52,6 +54,19 @@ namespace graphene { namespace chain {
 
    struct budget_record;
 
+   /** counters of the pending transaction pool, which is rebuilt whenever a block is pushed or generated */
+   struct pending_transactions_stats
+   {
+      uint32_t         pending_count = 0;
+      /// pending transactions applied again on top of a new head block or while generating a block
+      uint64_t         reapplied = 0;
+      /// pending transactions dropped because they expired or failed when applied again
+      uint64_t         dropped = 0;
+      uint64_t         rebuilds = 0;
+      fc::microseconds last_rebuild_time;
+      fc::microseconds total_rebuild_time;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -126,7 +141,10 @@ namespace graphene { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
-         const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
+         /// fc::raw packed block, read from the block log without unpacking it unless the block is only in the fork db
+         optional< vector<char> >   fetch_packed_block_by_id( const block_id_type& id )const;
+         /// looked up in the pending transactions or the block that included it, while it has not expired
+         signed_transaction         get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
          /**
@@ -161,6 +179,7 @@ namespace graphene { namespace chain {
 
          void pop_block();
          void clear_pending();
+         pending_transactions_stats get_pending_transactions_stats()const;
 
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
@@ -182,6 +201,13 @@ namespace graphene { namespace chain {
          // history object so other plugins that evaluate later can reference it.
          vector<optional< operation_history_object > >& get_applied_operations();
 
+         /**
+          *  The accounts the applied operation at op_index applies to: the accounts that authorize it, the accounts
+          *  it names, and the account it creates.  Computed once and shared by the plugins that index them, until
+          *  the get_applied_operations() are cleared.  Empty for an operation that was removed.
+          */
+         const flat_set<account_id_type>& get_applied_operation_impacted_accounts( size_t op_index )const;
+
          // the bookie plugin depends on change notifications that are skipped during normal replays
          void force_slow_replays();
 
@@ -207,18 +233,18 @@ namespace graphene { namespace chain {
           *  Emitted After a block has been applied and committed.  The callback
           *  should not yield and should execute quickly.
           */
-         fc::signal<void(const vector<object_id_type>&, const flat_set<account_id_type>&)> new_objects;
+         fc::signal<void(const vector<object_id_type>&, const lazy_account_set&)> new_objects;
 
          /**
           *  Emitted After a block has been applied and committed.  The callback
           *  should not yield and should execute quickly.
           */
-         fc::signal<void(const vector<object_id_type>&, const flat_set<account_id_type>&)> changed_objects;
+         fc::signal<void(const vector<object_id_type>&, const lazy_account_set&)> changed_objects;
 
          /** this signal is emitted any time an object is removed and contains a
           * pointer to the last value of every object that was removed.
           */
-         fc::signal<void(const vector<object_id_type>&, const vector<const object*>&, const flat_set<account_id_type>&)>  removed_objects;
+         fc::signal<void(const vector<object_id_type>&, const vector<const object*>&, const lazy_account_set&)>  removed_objects;
 
          //////////////////// db_witness_schedule.cpp ////////////////////
 
@@ -459,11 +485,31 @@ namespace graphene { namespace chain {
           * can be reapplied at the proper time */
          std::deque< signed_transaction >       _popped_tx;
 
+         /**
+          *  Pushes a popped or pending transaction again while the pending state is rebuilt, unless it is already
+          *  in the chain.  Transactions that no longer apply are dropped; expired ones without applying them,
+          *  which saves throwing and catching an exception for each of them.
+          *  @return true if the transaction is pending again
+          */
+         bool reapply_pending_transaction( const signed_transaction& trx );
+         /// @return true if a transaction that is applied again at the head block time would fail for having expired
+         bool is_expired_pending_transaction( const signed_transaction& trx )const;
+         void record_pending_rebuild( fc::microseconds elapsed );
+         pending_transactions_stats             _pending_tx_stats;
+
          /**
           * @}
           */
          /// Enable or disable tracking of votes of standby witnesses and committee members
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
+         /// Serve block lookups from memory mapped block log files, must be called before open()
+         inline void enable_mmap_block_reads(bool enable)  { _block_id_to_block.enable_mmap_reads(enable); }
+         /// Number of threads reading and decoding blocks ahead of the apply thread during replay, 0 to replay serially
+         inline void set_replay_threads(uint32_t num_threads)  { _replay_threads = num_threads; }
+         /// Number of threads recovering transaction signature keys of pushed blocks in parallel, 0 to disable
+         void set_signature_recovery_threads(uint32_t num_threads);
+         /// Number of threads counting votes during chain maintenance, 0 to count them while walking the accounts
+         void set_vote_tally_threads(uint32_t num_threads);
    protected:
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
          void pop_undo() { object_database::pop_undo(); }
@@ -488,6 +534,9 @@ namespace graphene { namespace chain {
       private:
          void                  _apply_block( const signed_block& next_block );
          processed_transaction _apply_transaction( const signed_transaction& trx );
+
+         /// Fills the cached signees of every transaction in the block, spread across the signature recovery pool
+         void                  precompute_signature_keys( const signed_block& block )const;
       
          ///Steps involved in applying a new block
          ///@{
@@ -536,7 +585,7 @@ namespace graphene { namespace chain {
             uint32_t get_gpos_current_subperiod();
 
          template<class Type>
-         void perform_account_maintenance(Type tally_helper);
+         void perform_account_maintenance(Type& tally_helper);
          ///@}
          ///@}
 
@@ -561,6 +610,8 @@ namespace graphene { namespace chain {
           * emited.
           */
          vector<optional<operation_history_object> >  _applied_ops;
+         /// lazily filled by get_applied_operation_impacted_accounts(), cleared with _applied_ops
+         mutable vector<optional<flat_set<account_id_type>>> _applied_ops_impacted;
 
          uint32_t                          _current_block_num    = 0;
          uint16_t                          _current_trx_in_block = 0;
@@ -582,6 +633,9 @@ namespace graphene { namespace chain {
 
          fc::hash_ctr_rng<secret_hash_type, 20> _random_number_generator;
          bool                              _slow_replays = false;
+         uint32_t                          _replay_threads = 0;
+         std::unique_ptr<graphene::db::thread_pool> _signature_recovery_pool;
+         std::unique_ptr<graphene::db::thread_pool> _vote_tally_pool;
 
          /**
           * Whether database is successfully opened or not.
@@ -625,3 +679,6 @@ namespace graphene { namespace chain {
    }
 
 } }
+
+FC_REFLECT( graphene::chain::pending_transactions_stats,
+            (pending_count)(reapplied)(dropped)(rebuilds)(last_rebuild_time)(total_rebuild_time) )
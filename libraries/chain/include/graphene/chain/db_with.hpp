@@ -76,36 +76,17 @@ struct pending_transactions_restorer
 
    ~pending_transactions_restorer()
    {
+      const fc::time_point start = fc::time_point::now();
       for( const auto& tx : _db._popped_tx )
-      {
-         try {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               // since push_transaction() takes a signed_transaction,
-               // the operation_results field will be ignored.
-               _db._push_transaction( tx );
-            }
-         } catch ( const fc::exception&  ) {
-         }
-      }
+         _db.reapply_pending_transaction( tx );
       _db._popped_tx.clear();
       for( const processed_transaction& tx : _pending_transactions )
       {
-         try
-         {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               // since push_transaction() takes a signed_transaction,
-               // the operation_results field will be ignored.
-               _db._push_transaction( tx );
-            }
-         }
-         catch( const fc::exception& e )
-         {
-            /*
-            wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", _db.head_block_id())("t",_db.head_block_time()) );
-            wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
-            */
-         }
+         // since push_transaction() takes a signed_transaction,
+         // the operation_results field will be ignored.
+         _db.reapply_pending_transaction( tx );
       }
+      _db.record_pending_rebuild( fc::time_point::now() - start );
    }
 
    database& _db;
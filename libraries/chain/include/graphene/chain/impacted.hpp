@@ -28,6 +28,8 @@
 #include <graphene/chain/protocol/transaction.hpp>
 #include <graphene/chain/protocol/types.hpp>
 
+#include <functional>
+
 namespace graphene { namespace chain {
 
 void operation_get_impacted_accounts(
@@ -39,4 +41,30 @@ void transaction_get_impacted_accounts(
    fc::flat_set<graphene::chain::account_id_type>& result
    );
 
+/**
+ * The accounts impacted by the objects of one database notification.  Walking the objects is only worth it for
+ * slots that look at the accounts, so they are computed the first time get() is called and then shared by all slots.
+ */
+class lazy_account_set
+{
+   public:
+      typedef std::function<void( fc::flat_set<account_id_type>& )> compute_function;
+
+      explicit lazy_account_set( compute_function compute ) : _compute( std::move( compute ) ) {}
+
+      const fc::flat_set<account_id_type>& get()const
+      {
+         if( _compute )
+         {
+            _compute( _accounts );
+            _compute = nullptr;
+         }
+         return _accounts;
+      }
+
+   private:
+      mutable compute_function              _compute;
+      mutable fc::flat_set<account_id_type> _accounts;
+};
+
 } } // graphene::app
\ No newline at end of file
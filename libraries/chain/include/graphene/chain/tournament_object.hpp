@@ -221,6 +221,7 @@ namespace graphene { namespace chain {
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual bool is_isolated()const override { return true; }
 
          /** given an account, map it to the set of tournaments in which that account is registered as a player */
          map< account_id_type, flat_set<tournament_id_type> > account_to_joined_tournaments;
@@ -231,6 +232,27 @@ namespace graphene { namespace chain {
          flat_set<account_id_type> before_account_ids;
    };
 
+   /**
+    *  @brief This secondary index records the tournaments whose matches have changed since
+    *  they were last examined, so the per-block tournament processing only has to look at
+    *  those.  It is attached to the match index.  Undoing a change goes through the same
+    *  callbacks, so tournaments affected by a reverted block are picked up again.
+    */
+   class tournament_progress_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void object_modified( const object& after  ) override;
+         virtual bool is_isolated()const override { return true; }
+
+         /** @return the tournaments with changed matches, and forget about them */
+         flat_set<tournament_id_type> take_changed_tournaments();
+         void clear_changed_tournaments() { changed_tournaments.clear(); }
+      protected:
+         flat_set<tournament_id_type> changed_tournaments;
+   };
+
 
 } }
 
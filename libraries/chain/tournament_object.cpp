@@ -718,6 +718,31 @@ namespace graphene { namespace chain {
          }
       }
    }
+
+   void tournament_progress_index::object_inserted(const object& obj)
+   {
+      assert( dynamic_cast<const match_object*>(&obj) ); // for debug only
+      changed_tournaments.insert(static_cast<const match_object&>(obj).tournament_id);
+   }
+
+   void tournament_progress_index::object_removed(const object& obj)
+   {
+      assert( dynamic_cast<const match_object*>(&obj) ); // for debug only
+      changed_tournaments.insert(static_cast<const match_object&>(obj).tournament_id);
+   }
+
+   void tournament_progress_index::object_modified(const object& after)
+   {
+      assert( dynamic_cast<const match_object*>(&after) ); // for debug only
+      changed_tournaments.insert(static_cast<const match_object&>(after).tournament_id);
+   }
+
+   flat_set<tournament_id_type> tournament_progress_index::take_changed_tournaments()
+   {
+      flat_set<tournament_id_type> result;
+      std::swap(result, changed_tournaments);
+      return result;
+   }
 } } // graphene::chain
 
 namespace fc { 
@@ -23,18 +23,35 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/thread_pool.hpp>
 
 #include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
 #include <fstream>
+#include <map>
 #include <stack>
 
 namespace graphene { namespace db {
    class object_database;
    using fc::path;
 
+   /**
+    *  Packed objects that replace what is stored in an index file when it is opened, keyed by
+    *  object id.  An empty value means the object has been removed.
+    */
+   typedef std::map< object_id_type, fc::optional< vector<char> > > object_overrides;
+
+   /** @return the id of a packed object, which is always its first serialized field */
+   inline object_id_type packed_object_id( const vector<char>& data )
+   {
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      object_id_type id;
+      fc::raw::unpack( ds, id );
+      return id;
+   }
+
    /**
     * @class index_observer
     * @brief used to get callbacks when objects change
@@ -96,7 +113,20 @@ namespace graphene { namespace db {
           *  Opens the index loading objects from a file
           */
          virtual void open( const fc::path& db ) = 0;
+         /**
+          *  Opens the index loading objects from a file, with @p overrides applied on top of the
+          *  file contents.  If @p pool is given, large files are decoded in chunks on the pool.
+          */
+         virtual void open( const fc::path& db, const object_overrides& overrides, thread_pool* pool ) = 0;
          virtual void save( const fc::path& db ) = 0;
+         /** Saves the index to a file, large indexes are encoded in chunks on @p pool if given */
+         virtual void save( const fc::path& db, thread_pool* pool ) = 0;
+
+         /**
+          *  Whether loading this index only touches the index itself, so it can be opened on a worker
+          *  thread concurrently with other indexes
+          */
+         virtual bool is_isolated_on_load()const = 0;
 
 
 
@@ -144,6 +174,12 @@ namespace graphene { namespace db {
          virtual void object_removed( const object& obj ){};
          virtual void about_to_modify( const object& before ){};
          virtual void object_modified( const object& after  ){};
+
+         /**
+          *  Whether the callbacks above only touch the secondary index's own state.  Primary indexes
+          *  whose secondary indexes all are isolated may be loaded concurrently with other indexes.
+          */
+         virtual bool is_isolated()const { return false; }
    };
 
    /**
@@ -173,6 +209,22 @@ namespace graphene { namespace db {
             return static_cast<T*>(_sindex.back().get());
          }
 
+         /** version hash written at the start of every index file, after the next id */
+         static fc::sha256 file_version()
+         {
+            std::string desc = "1.0";
+            return fc::sha256::hash(desc);
+         }
+
+         /** @return true if all secondary indexes are isolated */
+         bool secondary_indexes_isolated()const
+         {
+            for( const auto& item : _sindex )
+               if( !item->is_isolated() )
+                  return false;
+            return true;
+         }
+
          template<typename T>
          const T& get_secondary_index()const
          {
@@ -184,6 +236,17 @@ namespace graphene { namespace db {
             FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
          }
 
+         template<typename T>
+         T& get_secondary_index()
+         {
+            for( const auto& item : _sindex )
+            {
+               T* result = dynamic_cast<T*>(item.get());
+               if( result != nullptr ) return *result;
+            }
+            FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
+         }
+
       protected:
          vector< shared_ptr<index_observer> >   _observers;
          vector< unique_ptr<secondary_index> >  _sindex;
@@ -220,6 +283,8 @@ namespace graphene { namespace db {
 
          virtual ~direct_index(){}
 
+         virtual bool is_isolated()const override { return true; }
+
          virtual void object_inserted( const object& obj )
          {
             uint64_t instance = obj.id.instance();
@@ -338,30 +403,73 @@ namespace graphene { namespace db {
          
          fc::sha256 get_object_version()const
          {
-            std::string desc = "1.0";//get_type_description<object_type>();
-            return fc::sha256::hash(desc);
+            return base_primary_index::file_version();
          }
 
+         /// objects per chunk when decoding or encoding an index file on a thread pool
+         static const size_t chunk_size = 10000;
+
          virtual void open( const path& db )override
-         { 
-            if( !fc::exists( db ) ) return;
-            fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
-            fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
-            fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
-            fc::sha256 open_ver;
-
-            fc::raw::unpack(ds, _next_id);
-            fc::raw::unpack(ds, open_ver);
-            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            vector<char> tmp;
-            while( ds.remaining() > 0 ) 
+         {
+            open( db, object_overrides(), nullptr );
+         }
+
+         virtual void open( const path& db, const object_overrides& overrides, thread_pool* pool )override
+         {
+            if( fc::exists( db ) )
             {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
+               fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
+               fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
+               fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+               fc::sha256 open_ver;
+
+               fc::raw::unpack(ds, _next_id);
+               fc::raw::unpack(ds, open_ver);
+               FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+               vector< vector<char> > records;
+               while( ds.remaining() > 0 ) 
+               {
+                  records.emplace_back();
+                  fc::raw::unpack( ds, records.back() );
+                  if( !overrides.empty() && overrides.find( packed_object_id( records.back() ) ) != overrides.end() )
+                     records.pop_back();
+               }
+
+               if( pool != nullptr && records.size() > chunk_size )
+               {
+                  // unpacking is the expensive part and can be spread out, inserting must stay serial
+                  vector<object_type> objects( records.size() );
+                  vector< fc::future<void> > chunks;
+                  for( size_t begin = 0; begin < records.size(); begin += chunk_size )
+                  {
+                     const size_t end = std::min( records.size(), begin + chunk_size );
+                     chunks.push_back( pool->async( [&records,&objects,begin,end]() {
+                        for( size_t i = begin; i < end; ++i )
+                        {
+                           objects[i] = fc::raw::unpack<object_type>( records[i] );
+                           vector<char>().swap( records[i] );
+                        }
+                     }, "index open chunk" ) );
+                  }
+                  thread_pool::wait_all( chunks );
+                  for( auto& obj : objects )
+                     insert_loaded( std::move( obj ) );
+               }
+               else
+                  for( const auto& record : records )
+                     load( record );
             }
+            for( const auto& item : overrides )
+               if( item.second.valid() )
+                  load( *item.second );
          }
 
-         virtual void save( const path& db ) override 
+         virtual void save( const path& db ) override
+         {
+            save( db, nullptr );
+         }
+
+         virtual void save( const path& db, thread_pool* pool ) override
          {
             std::ofstream out( db.generic_string(), 
                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
@@ -369,21 +477,53 @@ namespace graphene { namespace db {
             auto ver  = get_object_version();
             fc::raw::pack( out, _next_id );
             fc::raw::pack( out, ver );
-            this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
-            });
+
+            vector<const object*> objects;
+            if( pool != nullptr )
+               this->inspect_all_objects( [&]( const object& o ) { objects.push_back( &o ); } );
+
+            if( objects.size() > chunk_size )
+            {
+               // pack chunks in parallel, write them in order
+               vector< fc::future< vector<char> > > chunks;
+               for( size_t begin = 0; begin < objects.size(); begin += chunk_size )
+               {
+                  const size_t end = std::min( objects.size(), begin + chunk_size );
+                  chunks.push_back( pool->async( [&objects,begin,end]() {
+                     vector<char> buffer;
+                     for( size_t i = begin; i < end; ++i )
+                     {
+                        auto vec = fc::raw::pack( static_cast<const object_type&>( *objects[i] ) );
+                        auto packed_vec = fc::raw::pack( vec );
+                        buffer.insert( buffer.end(), packed_vec.begin(), packed_vec.end() );
+                     }
+                     return buffer;
+                  }, "index save chunk" ) );
+               }
+               thread_pool::wait_all( chunks );
+               for( auto& chunk : chunks )
+               {
+                  const auto& buffer = chunk.wait();
+                  out.write( buffer.data(), buffer.size() );
+               }
+            }
+            else
+               this->inspect_all_objects( [&]( const object& o ) {
+                   auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
+                   auto packed_vec = fc::raw::pack( vec );
+                   out.write( packed_vec.data(), packed_vec.size() );
+               });
          }
 
-         virtual const object&  load( const std::vector<char>& data )override
+         virtual bool is_isolated_on_load()const override
          {
-            const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
-            return result;
+            return secondary_indexes_isolated();
          }
 
+         virtual const object&  load( const std::vector<char>& data )override
+         {
+            return insert_loaded( fc::raw::unpack<object_type>( data ) );
+         }
 
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
@@ -437,6 +577,14 @@ namespace graphene { namespace db {
          }
 
       private:
+         const object& insert_loaded( object_type&& obj )
+         {
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
          object_id_type                                 _next_id;
          const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
    };
@@ -27,6 +27,8 @@
 #include <fc/crypto/city.hpp>
 #include <fc/uint128.hpp>
 
+#include <new>
+
 #define MAX_NESTING (200)
 
 namespace graphene { namespace db {
@@ -74,6 +76,9 @@ namespace graphene { namespace db {
 
          /// these methods are implemented for derived classes by inheriting abstract_object<DerivedClass>
          virtual unique_ptr<object> clone()const = 0;
+         /// copy constructs this object into @p storage, which must hold at least storage_size() bytes
+         virtual object*            clone_into( void* storage )const = 0;
+         virtual size_t             storage_size()const = 0;
          virtual void               move_from( object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
          virtual vector<char>       pack()const = 0;
@@ -95,6 +100,11 @@ namespace graphene { namespace db {
          {
             return unique_ptr<object>(new DerivedClass( *static_cast<const DerivedClass*>(this) ));
          }
+         virtual object* clone_into( void* storage )const
+         {
+            return new (storage) DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
+         virtual size_t storage_size()const { return sizeof(DerivedClass); }
 
          virtual void    move_from( object& obj )
          {
@@ -47,9 +47,25 @@ namespace graphene { namespace db {
          void open(const fc::path& data_dir );
 
          /**
-          * Saves the complete state of the object_database to disk, this could take a while
+          * Saves the state of the object_database to disk.
+          *
+          * While a full checkpoint exists and fewer than max_checkpoint_deltas() deltas have been
+          * written on top of it, only the objects created, modified or removed since the last flush
+          * are written, as a new delta.  Otherwise the deltas are compacted by saving the complete
+          * state, which could take a while.
           */
          void flush();
+         /**
+          * Maximum number of incremental checkpoints written on top of a full one before they are
+          * compacted, 0 to always save the complete state
+          */
+         void     set_max_checkpoint_deltas( uint32_t max_deltas ) { _max_checkpoint_deltas = max_deltas; }
+         uint32_t max_checkpoint_deltas()const { return _max_checkpoint_deltas; }
+         /**
+          * Number of threads opening and saving indexes concurrently during open() and full checkpoints,
+          * large indexes are additionally split into chunks.  0 does everything on the calling thread.
+          */
+         void     set_checkpoint_threads( uint32_t num_threads ) { _checkpoint_threads = num_threads; }
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -75,6 +91,14 @@ namespace graphene { namespace db {
          const index&  get_index()const { return get_index(T::space_id,T::type_id); }
          const index&  get_index(uint8_t space_id, uint8_t type_id)const;
          const index&  get_index(object_id_type id)const { return get_index(id.space(),id.type()); }
+         /// calls @p f for every registered index, in space / type order
+         void inspect_all_indexes( const std::function<void(const index&)>& f )const
+         {
+            for( const auto& space : _index )
+               for( const auto& idx : space )
+                  if( idx )
+                     f( *idx );
+         }
          /// @}
 
          const object& get_object( object_id_type id )const;
@@ -84,7 +108,11 @@ namespace graphene { namespace db {
          /// in order to maintain proper undo history.
          ///@{
 
-         const object& insert( object&& obj ) { return get_mutable_index(obj.id).insert( std::move(obj) ); }
+         const object& insert( object&& obj )
+         {
+            mark_dirty( obj.id );
+            return get_mutable_index(obj.id).insert( std::move(obj) );
+         }
          void          remove( const object& obj ) { get_mutable_index(obj.id).remove( obj ); }
          template<typename T, typename Lambda>
          void modify( const T& obj, const Lambda& m ) {
@@ -163,9 +191,26 @@ namespace graphene { namespace db {
          void save_undo( const object& obj );
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
+         void mark_dirty( object_id_type id );
+         void clear_dirty() { _dirty_instances.clear(); }
+
+         fc::path checkpoint_delta_path( uint32_t n )const;
+         void     save_full_checkpoint();
+         void     save_checkpoint_delta();
+         /// reads all deltas on disk, leaving the latest next ids of all indexes in @p next_ids
+         std::map< uint16_t, object_overrides > load_checkpoint_deltas( vector<object_id_type>& next_ids );
+         static void report_index_time( const char* what, const index* idx, const fc::time_point& start );
 
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+
+         /// per space and type, one bit per instance of the objects created, modified or removed since
+         /// the last checkpoint, so the bookkeeping never outgrows the indexes themselves
+         vector< vector< vector<bool> > >                          _dirty_instances;
+         /// number of deltas on top of the full checkpoint on disk
+         uint32_t                                                  _checkpoint_deltas = 0;
+         uint32_t                                                  _max_checkpoint_deltas = 16;
+         uint32_t                                                  _checkpoint_threads = 0;
    };
 
 } } // graphene::db
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    *  @brief A fixed set of fc::threads to spread independent work across cores
+    *
+    *  Tasks are handed to the threads round robin, callers wait on the returned
+    *  futures.  A task must only touch state that is guaranteed not to change until
+    *  its future has been waited on.
+    */
+   class thread_pool
+   {
+      public:
+         /// @param num_threads number of worker threads, 0 for one per hardware thread
+         explicit thread_pool( uint32_t num_threads = 0, const std::string& name = "worker" );
+         ~thread_pool();
+
+         uint32_t size()const { return _threads.size(); }
+
+         template<typename Functor>
+         auto async( Functor&& f, const char* desc = "thread_pool task" ) -> fc::future<decltype(f())>
+         {
+            return _threads[ _next_thread++ % _threads.size() ]->async( std::forward<Functor>(f), desc );
+         }
+
+         /**
+          *  Calls f( i ) for every i in [0, count), split into one contiguous range per
+          *  thread, and waits for all of them.  The first exception thrown by any range
+          *  is rethrown after all ranges have finished.
+          */
+         template<typename Functor>
+         void for_each_index( size_t count, const Functor& f, const char* desc = "thread_pool range" )
+         {
+            if( count == 0 )
+               return;
+            const size_t chunks = std::min<size_t>( count, size() );
+            std::vector< fc::future<void> > results;
+            results.reserve( chunks );
+            for( size_t c = 0; c < chunks; ++c )
+            {
+               const size_t begin = count * c / chunks;
+               const size_t end   = count * (c + 1) / chunks;
+               results.push_back( async( [&f,begin,end]() {
+                  for( size_t i = begin; i < end; ++i )
+                     f( i );
+               }, desc ) );
+            }
+            wait_all( results );
+         }
+
+         /// waits for every future, then rethrows the first exception, if any
+         template<typename T>
+         static void wait_all( std::vector< fc::future<T> >& results )
+         {
+            fc::exception_ptr first_error;
+            for( auto& r : results )
+            {
+               try
+               {
+                  r.wait();
+               }
+               catch( const fc::exception& e )
+               {
+                  if( !first_error )
+                     first_error = e.dynamic_copy_exception();
+               }
+            }
+            if( first_error )
+               first_error->dynamic_rethrow_exception();
+         }
+
+      private:
+         std::vector< std::unique_ptr<fc::thread> > _threads;
+         std::atomic<uint32_t>                      _next_thread{0};
+   };
+
+} } // graphene::db
@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <vector>
+#include <fc/container/flat.hpp>
 #include <fc/exception/exception.hpp>
 
 namespace graphene { namespace db {
@@ -32,12 +34,121 @@ namespace graphene { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    *  @brief recycles the fixed size memory blocks used by @ref undo_arena
+    *
+    *  Undo states come and go with every pending transaction and block, keeping their
+    *  blocks around saves going back to the allocator for every new state.
+    */
+   class undo_block_pool
+   {
+      public:
+         static const size_t block_size = 64 * 1024;
+
+         undo_block_pool() {}
+         undo_block_pool( const undo_block_pool& ) = delete;
+         undo_block_pool& operator = ( const undo_block_pool& ) = delete;
+         ~undo_block_pool();
+
+         char* acquire();
+         void  release( char* block );
+
+      private:
+         /// upper bound on the number of idle blocks kept around
+         static const size_t max_free_blocks = 256;
+         std::vector<char*> _free_blocks;
+   };
+
+   /**
+    *  @brief bump allocator for the object snapshots of one undo_state
+    *
+    *  Memory is never freed piecemeal: everything allocated from the arena is released
+    *  at once when the arena is cleared or destroyed.  Destructors of objects living in
+    *  the arena are not called by the arena.
+    */
+   class undo_arena
+   {
+      public:
+         explicit undo_arena( undo_block_pool* pool = nullptr ) : _pool( pool ) {}
+         undo_arena( undo_arena&& mv );
+         undo_arena& operator = ( undo_arena&& mv );
+         ~undo_arena() { clear(); }
+
+         void* allocate( size_t size );
+         /// takes over all memory of @p other, which is left empty
+         void  absorb( undo_arena& other );
+         void  clear();
+
+      private:
+         struct block
+         {
+            char* data;
+            bool  pooled;
+         };
+
+         undo_block_pool*   _pool;
+         std::vector<block> _blocks;
+         char*              _pos  = nullptr;
+         size_t             _left = 0;
+   };
+
+   /**
+    *  One entry of the undo log.  There is at most one live record per object id in an
+    *  undo_state; later changes to the same object update the record in place.
+    */
+   struct undo_record
+   {
+      enum kind_type : uint8_t
+      {
+         created,  ///< object was created, undo removes it
+         modified, ///< object was modified, undo restores snapshot
+         removed,  ///< object was removed, undo inserts snapshot
+         cancelled ///< object was created and removed again, nothing to undo
+      };
+
+      object_id_type id;
+      /// pre-modification or pre-removal value, allocated from the state's arena
+      object*        snapshot = nullptr;
+      kind_type      kind;
+   };
+
+   /**
+    *  All changes made during one undo session, as a flat, append-only log of
+    *  undo_records.  Snapshots are allocated from a per-state arena, so discarding or
+    *  merging a state releases or hands over all of its memory in one go.
+    */
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
-      unordered_map<object_id_type, object_id_type>      old_index_next_ids;
-      std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      explicit undo_state( undo_block_pool* pool = nullptr ) : arena( pool ) {}
+      undo_state( undo_state&& mv ) = default;
+      undo_state& operator = ( undo_state&& mv ) = delete;
+      ~undo_state() { destroy_snapshots(); }
+
+      /// @return the live record for @p id, or nullptr if the object was not touched in this state
+      undo_record*       find( object_id_type id );
+      const undo_record* find( object_id_type id )const;
+      undo_record&       append( object_id_type id, undo_record::kind_type kind, object* snapshot = nullptr );
+      /// copies @p obj into the arena
+      object*            snapshot( const object& obj );
+      void               destroy_snapshot( undo_record& rec );
+      void               destroy_snapshots();
+
+      /// calls f( const undo_record& ) for every record of the given kind, in the order they were recorded
+      template<typename Functor>
+      void for_each( undo_record::kind_type kind, Functor&& f )const
+      {
+         for( const auto& rec : records )
+            if( rec.kind == kind )
+               f( rec );
+      }
+
+      size_t count( undo_record::kind_type kind )const;
+
+      vector<undo_record>                            records;
+      /// position of each object's live record in @ref records
+      unordered_map<object_id_type, uint32_t>        record_index;
+      flat_map<object_id_type, object_id_type>       old_index_next_ids;
+      undo_arena                                     arena;
    };
 
 
@@ -136,9 +247,14 @@ namespace graphene { namespace db {
          void undo();
          void merge();
          void commit();
+         /// reverts all changes recorded in @p state, which must be the top of the stack
+         void apply_undo( undo_state& state );
+         undo_state& current_state();
 
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
+         /// declared before _stack, states return their blocks to the pool on destruction
+         undo_block_pool         _block_pool;
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
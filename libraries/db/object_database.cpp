@@ -69,22 +69,152 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 }
 
 void object_database::flush()
+{
+   if( _max_checkpoint_deltas > 0 && _checkpoint_deltas < _max_checkpoint_deltas
+       && fc::exists( _data_dir / "object_database" ) && !fc::exists( _data_dir / "object_database" / "lock" ) )
+      save_checkpoint_delta();
+   else
+      save_full_checkpoint();
+}
+
+fc::path object_database::checkpoint_delta_path( uint32_t n )const
+{
+   return _data_dir / "object_database" / ( "delta." + fc::to_string( n ) );
+}
+
+void object_database::save_full_checkpoint()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
    fc::create_directories( _data_dir / "object_database.tmp" / "lock" );
    for( uint32_t space = 0; space < _index.size(); ++space )
-   {
       fc::create_directories( _data_dir / "object_database.tmp" / fc::to_string(space) );
+
+   // saving only reads the indexes, all of them can be written concurrently
+   std::unique_ptr<thread_pool> pool;
+   if( _checkpoint_threads > 0 )
+      pool.reset( new thread_pool( _checkpoint_threads, "checkpoint" ) );
+   vector< fc::future<void> > results;
+   for( uint32_t space = 0; space < _index.size(); ++space )
+   {
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
-            _index[space][type]->save( _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
+         {
+            index* idx = _index[space][type].get();
+            const fc::path file = _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type);
+            thread_pool* p = pool.get();
+            auto task = [idx,file,p]() {
+               const fc::time_point start = fc::time_point::now();
+               idx->save( file, p );
+               report_index_time( "Saved", idx, start );
+            };
+            if( pool )
+               results.push_back( pool->async( task, "save index" ) );
+            else
+               task();
+         }
    }
+   thread_pool::wait_all( results );
+
    fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
    if( fc::exists( _data_dir / "object_database" ) )
       fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
    fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
    fc::remove_all( _data_dir / "object_database.old" );
+   // the deltas went away together with the old directory
+   _checkpoint_deltas = 0;
+   clear_dirty();
+}
+
+void object_database::report_index_time( const char* what, const index* idx, const fc::time_point& start )
+{
+   const int64_t ms = ( fc::time_point::now() - start ).count() / 1000;
+   if( ms >= 100 )
+      ilog( "${what} index ${s}.${t} in ${ms} ms", ("what",what)("s",idx->object_space_id())("t",idx->object_type_id())("ms",ms) );
+   else
+      dlog( "${what} index ${s}.${t} in ${ms} ms", ("what",what)("s",idx->object_space_id())("t",idx->object_type_id())("ms",ms) );
+}
+
+/**
+ * A delta holds the next ids of all indexes followed by one record per object touched since the
+ * previous checkpoint: its id, whether it still exists and, if so, the packed object.  It is
+ * written under a temporary name and renamed, so a delta on disk is always complete.
+ */
+void object_database::save_checkpoint_delta()
+{
+   const uint32_t n = _checkpoint_deltas + 1;
+   const fc::path final_path = checkpoint_delta_path( n );
+   const fc::path tmp_path = final_path.generic_string() + ".tmp";
+   {
+      std::ofstream out( tmp_path.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out, "Unable to write object database checkpoint ${f}", ("f", tmp_path) );
+
+      vector<object_id_type> next_ids;
+      for( const auto& space : _index )
+         for( const auto& idx : space )
+            if( idx )
+               next_ids.push_back( idx->get_next_id() );
+      fc::raw::pack( out, next_ids );
+
+      for( uint32_t space = 0; space < _dirty_instances.size(); ++space )
+         for( uint32_t type = 0; type < _dirty_instances[space].size(); ++type )
+         {
+            const vector<bool>& dirty = _dirty_instances[space][type];
+            for( uint64_t instance = 0; instance < dirty.size(); ++instance )
+               if( dirty[instance] )
+               {
+                  const object_id_type id( space, type, instance );
+                  const object* obj = find_object( id );
+                  fc::raw::pack( out, id );
+                  fc::raw::pack( out, obj != nullptr );
+                  if( obj != nullptr )
+                     fc::raw::pack( out, obj->pack() );
+               }
+         }
+      out.flush();
+      FC_ASSERT( out, "Unable to write object database checkpoint ${f}", ("f", tmp_path) );
+   }
+   fc::rename( tmp_path, final_path );
+   _checkpoint_deltas = n;
+   clear_dirty();
+}
+
+std::map< uint16_t, object_overrides > object_database::load_checkpoint_deltas( vector<object_id_type>& next_ids )
+{
+   std::map< uint16_t, object_overrides > result;
+   _checkpoint_deltas = 0;
+   for( uint32_t n = 1; fc::exists( checkpoint_delta_path( n ) ); ++n )
+   {
+      const fc::path delta = checkpoint_delta_path( n );
+      const auto size = fc::file_size( delta );
+      if( size == 0 )
+         break;
+      fc::file_mapping fm( delta.generic_string().c_str(), fc::read_only );
+      fc::mapped_region mr( fm, fc::read_only, 0, size );
+      fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+
+      fc::raw::unpack( ds, next_ids );
+      while( ds.remaining() > 0 )
+      {
+         object_id_type id;
+         bool exists;
+         fc::raw::unpack( ds, id );
+         fc::raw::unpack( ds, exists );
+         auto& entry = result[ uint16_t( id.space() ) << 8 | id.type() ][ id ];
+         if( exists )
+         {
+            vector<char> data;
+            fc::raw::unpack( ds, data );
+            entry = fc::optional< vector<char> >( std::move( data ) );
+         }
+         else
+            entry.reset();
+      }
+      _checkpoint_deltas = n;
+   }
+   if( _checkpoint_deltas > 0 )
+      ilog( "Applying ${n} incremental checkpoints", ("n", _checkpoint_deltas) );
+   return result;
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -92,6 +222,8 @@ void object_database::wipe(const fc::path& data_dir)
    close();
    ilog("Wiping object database...");
    fc::remove_all(data_dir / "object_database");
+   _checkpoint_deltas = 0;
+   clear_dirty();
    ilog("Done wiping object databse.");
 }
 
@@ -104,10 +236,43 @@ void object_database::open(const fc::path& data_dir)
        return;
    }
    ilog("Opening object database from ${d} ...", ("d", data_dir));
+   vector<object_id_type> next_ids;
+   const auto overrides = load_checkpoint_deltas( next_ids );
+   const object_overrides no_overrides;
+
+   std::unique_ptr<thread_pool> pool;
+   if( _checkpoint_threads > 0 )
+      pool.reset( new thread_pool( _checkpoint_threads, "checkpoint" ) );
+   // indexes whose secondary indexes reach into other indexes while loading are opened on this thread,
+   // after everything before them is done, so they see the same state as with a serial open
+   vector< fc::future<void> > results;
    for( uint32_t space = 0; space < _index.size(); ++space )
       for( uint32_t type = 0; type  < _index[space].size(); ++type )
          if( _index[space][type] )
-            _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
+         {
+            index* idx = _index[space][type].get();
+            const fc::path file = _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type);
+            auto itr = overrides.find( uint16_t( space ) << 8 | type );
+            const object_overrides* idx_overrides = itr != overrides.end() ? &itr->second : &no_overrides;
+            thread_pool* p = pool.get();
+            auto task = [idx,file,idx_overrides,p]() {
+               const fc::time_point start = fc::time_point::now();
+               idx->open( file, *idx_overrides, p );
+               report_index_time( "Opened", idx, start );
+            };
+            if( pool && idx->is_isolated_on_load() )
+               results.push_back( pool->async( task, "open index" ) );
+            else
+            {
+               thread_pool::wait_all( results );
+               results.clear();
+               task();
+            }
+         }
+   thread_pool::wait_all( results );
+   for( const auto& id : next_ids )
+      get_mutable_index( id.space(), id.type() ).set_next_id( id );
+   clear_dirty();
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -118,18 +283,34 @@ void object_database::pop_undo()
    _undo_db.pop_commit();
 } FC_CAPTURE_AND_RETHROW() }
 
+void object_database::mark_dirty( object_id_type id )
+{
+   if( _dirty_instances.size() <= id.space() )
+      _dirty_instances.resize( id.space() + 1 );
+   auto& types = _dirty_instances[id.space()];
+   if( types.size() <= id.type() )
+      types.resize( id.type() + 1 );
+   auto& dirty = types[id.type()];
+   if( dirty.size() <= id.instance() )
+      dirty.resize( id.instance() + 1 );
+   dirty[id.instance()] = true;
+}
+
 void object_database::save_undo( const object& obj )
 {
+   mark_dirty( obj.id );
    _undo_db.on_modify( obj );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
+   mark_dirty( obj.id );
    _undo_db.on_create( obj );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
+   mark_dirty( obj.id );
    _undo_db.on_remove( obj );
 }
 
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/db/thread_pool.hpp>
+
+#include <thread>
+
+namespace graphene { namespace db {
+
+thread_pool::thread_pool( uint32_t num_threads, const std::string& name )
+{
+   if( num_threads == 0 )
+      num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+   _threads.reserve( num_threads );
+   for( uint32_t i = 0; i < num_threads; ++i )
+      _threads.emplace_back( new fc::thread( name + "-" + std::to_string( i ) ) );
+}
+
+thread_pool::~thread_pool()
+{
+   for( auto& t : _threads )
+      t->quit();
+}
+
+} } // graphene::db
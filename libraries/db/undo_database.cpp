@@ -25,8 +25,164 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <cstddef>
+
 namespace graphene { namespace db {
 
+undo_block_pool::~undo_block_pool()
+{
+   for( char* b : _free_blocks )
+      delete[] b;
+}
+
+char* undo_block_pool::acquire()
+{
+   if( _free_blocks.empty() )
+      return new char[block_size];
+   char* b = _free_blocks.back();
+   _free_blocks.pop_back();
+   return b;
+}
+
+void undo_block_pool::release( char* block )
+{
+   if( _free_blocks.size() < max_free_blocks )
+      _free_blocks.push_back( block );
+   else
+      delete[] block;
+}
+
+undo_arena::undo_arena( undo_arena&& mv )
+   : _pool( mv._pool ), _blocks( std::move(mv._blocks) ), _pos( mv._pos ), _left( mv._left )
+{
+   mv._blocks.clear();
+   mv._pos = nullptr;
+   mv._left = 0;
+}
+
+undo_arena& undo_arena::operator = ( undo_arena&& mv )
+{
+   if( this == &mv ) return *this;
+   clear();
+   _pool = mv._pool;
+   _blocks = std::move(mv._blocks);
+   _pos = mv._pos;
+   _left = mv._left;
+   mv._blocks.clear();
+   mv._pos = nullptr;
+   mv._left = 0;
+   return *this;
+}
+
+void* undo_arena::allocate( size_t size )
+{
+   const size_t align = alignof(std::max_align_t);
+   size = ( size + align - 1 ) & ~( align - 1 );
+   if( size > _left )
+   {
+      if( _pool && size <= undo_block_pool::block_size )
+      {
+         _blocks.push_back( block{ _pool->acquire(), true } );
+         _left = undo_block_pool::block_size;
+      }
+      else
+      {
+         // oversized objects, or no pool to share blocks with
+         const size_t bytes = std::max( size, size_t( undo_block_pool::block_size ) );
+         _blocks.push_back( block{ new char[bytes], false } );
+         _left = bytes;
+      }
+      _pos = _blocks.back().data;
+   }
+   void* result = _pos;
+   _pos += size;
+   _left -= size;
+   return result;
+}
+
+void undo_arena::absorb( undo_arena& other )
+{
+   if( _blocks.empty() )
+   {
+      _pos = other._pos;
+      _left = other._left;
+   }
+   // where the blocks sit in the list does not matter, _pos keeps pointing into our current block
+   _blocks.insert( _blocks.end(), other._blocks.begin(), other._blocks.end() );
+   other._blocks.clear();
+   other._pos = nullptr;
+   other._left = 0;
+}
+
+void undo_arena::clear()
+{
+   for( const auto& b : _blocks )
+   {
+      if( b.pooled && _pool )
+         _pool->release( b.data );
+      else
+         delete[] b.data;
+   }
+   _blocks.clear();
+   _pos = nullptr;
+   _left = 0;
+}
+
+undo_record* undo_state::find( object_id_type id )
+{
+   auto itr = record_index.find( id );
+   if( itr == record_index.end() ) return nullptr;
+   return &records[itr->second];
+}
+
+const undo_record* undo_state::find( object_id_type id )const
+{
+   auto itr = record_index.find( id );
+   if( itr == record_index.end() ) return nullptr;
+   return &records[itr->second];
+}
+
+undo_record& undo_state::append( object_id_type id, undo_record::kind_type kind, object* snapshot )
+{
+   record_index[id] = records.size();
+   records.emplace_back();
+   undo_record& rec = records.back();
+   rec.id = id;
+   rec.kind = kind;
+   rec.snapshot = snapshot;
+   return rec;
+}
+
+object* undo_state::snapshot( const object& obj )
+{
+   return obj.clone_into( arena.allocate( obj.storage_size() ) );
+}
+
+void undo_state::destroy_snapshot( undo_record& rec )
+{
+   if( rec.snapshot )
+   {
+      rec.snapshot->~object();
+      rec.snapshot = nullptr;
+   }
+}
+
+void undo_state::destroy_snapshots()
+{
+   // the memory goes back with the arena, only the destructors are run here
+   for( auto& rec : records )
+      destroy_snapshot( rec );
+}
+
+size_t undo_state::count( undo_record::kind_type kind )const
+{
+   size_t result = 0;
+   for( const auto& rec : records )
+      if( rec.kind == kind )
+         ++result;
+   return result;
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -40,84 +196,86 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
    while( size() > max_size() )
       _stack.pop_front();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_block_pool );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
+
+undo_state& undo_database::current_state()
+{
+   if( _stack.empty() )
+      _stack.emplace_back( &_block_pool );
+   return _stack.back();
+}
+
 void undo_database::on_create( const object& obj )
 {
    if( _disabled ) return;
 
-   if( _stack.empty() )
-      _stack.emplace_back();
-   auto& state = _stack.back();
+   auto& state = current_state();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
    if( itr == state.old_index_next_ids.end() )
       state.old_index_next_ids[index_id] = obj.id;
-   state.new_ids.insert(obj.id);
+   state.append( obj.id, undo_record::created );
 }
 void undo_database::on_modify( const object& obj )
 {
    if( _disabled ) return;
 
-   if( _stack.empty() )
-      _stack.emplace_back();
-   auto& state = _stack.back();
-   if( state.new_ids.find(obj.id) != state.new_ids.end() )
+   auto& state = current_state();
+   // new objects are simply removed on undo, and the first snapshot is the one to restore
+   if( state.find(obj.id) != nullptr )
       return;
-   auto itr =  state.old_values.find(obj.id);
-   if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.append( obj.id, undo_record::modified, state.snapshot( obj ) );
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
-   if( _stack.empty() )
-      _stack.emplace_back();
-   undo_state& state = _stack.back();
-   if( state.new_ids.count(obj.id) )
-   {
-      state.new_ids.erase(obj.id);
-      return;
-   }
-   if( state.old_values.count(obj.id) )
+   undo_state& state = current_state();
+   undo_record* rec = state.find( obj.id );
+   if( rec == nullptr )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
-      state.old_values.erase(obj.id);
+      state.append( obj.id, undo_record::removed, state.snapshot( obj ) );
       return;
    }
-   if( state.removed.count(obj.id) ) return;
-   state.removed[obj.id] = obj.clone();
+   if( rec->kind == undo_record::created )
+      rec->kind = undo_record::cancelled;
+   else if( rec->kind == undo_record::modified )
+      rec->kind = undo_record::removed;
 }
 
-void undo_database::undo()
-{ try {
-   FC_ASSERT( !_disabled );
-   FC_ASSERT( _active_sessions > 0 );
-   disable();
-
-   auto& state = _stack.back();
-   for( auto& item : state.old_values )
-   {
-      _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-   }
+void undo_database::apply_undo( undo_state& state )
+{
+   for( auto& rec : state.records )
+      if( rec.kind == undo_record::modified )
+         _db.modify( _db.get_object( rec.id ), [&]( object& obj ){ obj.move_from( *rec.snapshot ); } );
 
-   for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
-   {
-      _db.remove( _db.get_object(*ritr) );
-   }
+   for( const auto& rec : state.records )
+      if( rec.kind == undo_record::created )
+         _db.remove( _db.get_object( rec.id ) );
 
    for( auto& item : state.old_index_next_ids )
    {
       _db.get_mutable_index( item.first.space(), item.first.type() ).set_next_id( item.second );
    }
 
-   for( auto& item : state.removed )
-      _db.insert( std::move(*item.second) );
+   for( auto& rec : state.records )
+      if( rec.kind == undo_record::removed )
+         _db.insert( std::move(*rec.snapshot) );
 
    _stack.pop_back();
+}
+
+void undo_database::undo()
+{ try {
+   FC_ASSERT( !_disabled );
+   FC_ASSERT( _active_sessions > 0 );
+   disable();
+
+   apply_undo( _stack.back() );
+
    enable();
    --_active_sessions;
 } FC_CAPTURE_AND_RETHROW() }
@@ -135,11 +293,11 @@ void undo_database::merge()
    auto& state = _stack.back();
    auto& prev_state = _stack[_stack.size()-2];
 
-   // An object's relationship to a state can be:
-   // in new_ids            : new
-   // in old_values (was=X) : upd(was=X)
-   // in removed (was=X)    : del(was=X)
-   // not in any of above   : nop
+   // An object's relationship to a state is given by its live record there:
+   // undo_record::created                 : new
+   // undo_record::modified (snapshot=X)   : upd(was=X)
+   // undo_record::removed (snapshot=X)    : del(was=X)
+   // undo_record::cancelled, or no record : nop
    //
    // When merging A=prev_state and B=state we have a 4x4 matrix of all possibilities:
    //
@@ -175,70 +333,70 @@ void undo_database::merge()
    // (a serious logic error which should never happen).
    //
 
-   // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
+   // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's records.
+   // Snapshots that survive the merge are handed over to prev_state together with state's arena, the others
+   // are destroyed right away.
 
-   // *+upd
-   for( auto& obj : state.old_values )
+   prev_state.records.reserve( prev_state.records.size() + state.records.size() );
+   for( auto& rec : state.records )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
-      {
-         // new+upd -> new, type A
-         continue;
-      }
-      if( prev_state.old_values.find(obj.second->id) != prev_state.old_values.end() )
+      undo_record* prev = prev_state.find( rec.id );
+      switch( rec.kind )
       {
-         // upd(was=X) + upd(was=Y) -> upd(was=X), type A
-         continue;
+         case undo_record::created:
+            // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
+            assert( prev == nullptr );
+            prev_state.append( rec.id, undo_record::created );
+            break;
+         case undo_record::modified:
+            if( prev != nullptr )
+            {
+               // new+upd -> new, upd(was=X) + upd(was=Y) -> upd(was=X), type A
+               // del+upd -> N/A
+               assert( prev->kind != undo_record::removed );
+               state.destroy_snapshot( rec );
+               break;
+            }
+            // nop+upd(was=Y) -> upd(was=Y), type B
+            prev_state.append( rec.id, undo_record::modified, rec.snapshot );
+            rec.snapshot = nullptr;
+            break;
+         case undo_record::removed:
+            if( prev != nullptr && prev->kind == undo_record::created )
+            {
+               // new + del -> nop (type C)
+               prev->kind = undo_record::cancelled;
+               state.destroy_snapshot( rec );
+               break;
+            }
+            if( prev != nullptr && prev->kind == undo_record::modified )
+            {
+               // upd(was=X) + del(was=Y) -> del(was=X)
+               prev->kind = undo_record::removed;
+               state.destroy_snapshot( rec );
+               break;
+            }
+            // del + del -> N/A
+            assert( prev == nullptr || prev->kind == undo_record::cancelled );
+            // nop + del(was=Y) -> del(was=Y)
+            prev_state.append( rec.id, undo_record::removed, rec.snapshot );
+            rec.snapshot = nullptr;
+            break;
+         case undo_record::cancelled:
+            break;
       }
-      // del+upd -> N/A
-      assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
-      // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
    }
 
-   // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
-   for( auto id : state.new_ids )
-      prev_state.new_ids.insert(id);
-
    // old_index_next_ids can only be updated, iterate over *+upd cases
    for( auto& item : state.old_index_next_ids )
    {
+      // nop+upd(was=Y) -> upd(was=Y), type B
+      // upd(was=X)+upd(was=Y) -> upd(was=X), type A, which is a no-op
       if( prev_state.old_index_next_ids.find( item.first ) == prev_state.old_index_next_ids.end() )
-      {
-         // nop+upd(was=Y) -> upd(was=Y), type B
          prev_state.old_index_next_ids[item.first] = item.second;
-         continue;
-      }
-      else
-      {
-         // upd(was=X)+upd(was=Y) -> upd(was=X), type A
-         // type A implementation is a no-op, as discussed above, so there is no code here
-         continue;
-      }
    }
 
-   // *+del
-   for( auto& obj : state.removed )
-   {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
-      {
-         // new + del -> nop (type C)
-         prev_state.new_ids.erase(obj.second->id);
-         continue;
-      }
-      auto it = prev_state.old_values.find(obj.second->id);
-      if( it != prev_state.old_values.end() )
-      {
-         // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
-         prev_state.old_values.erase(obj.second->id);
-         continue;
-      }
-      // del + del -> N/A
-      assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
-      // nop + del(was=Y) -> del(was=Y)
-      prev_state.removed[obj.second->id] = std::move(obj.second);
-   }
+   prev_state.arena.absorb( state.arena );
    _stack.pop_back();
    --_active_sessions;
 }
@@ -255,27 +413,7 @@ void undo_database::pop_commit()
 
    disable();
    try {
-      auto& state = _stack.back();
-
-      for( auto& item : state.old_values )
-      {
-         _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-      }
-
-      for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
-      {
-         _db.remove( _db.get_object(*ritr) );
-      }
-
-      for( auto& item : state.old_index_next_ids )
-      {
-         _db.get_mutable_index( item.first.space(), item.first.type() ).set_next_id( item.second );
-      }
-
-      for( auto& item : state.removed )
-         _db.insert( std::move(*item.second) );
-
-      _stack.pop_back();
+      apply_undo( _stack.back() );
    }
    catch ( const fc::exception& e )
    {
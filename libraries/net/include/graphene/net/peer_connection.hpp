@@ -37,7 +37,7 @@
 #include <boost/multi_index/tag.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
-#include <queue>
+#include <boost/circular_buffer.hpp>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
 
@@ -65,7 +65,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual std::shared_ptr<const message> get_message_for_item(item_id item) = 0;
     };
 
     class peer_connection;
@@ -107,64 +107,42 @@ namespace graphene { namespace net
       fc::optional<fc::ip::endpoint> _remote_endpoint;
       message_oriented_connection    _message_connection;
 
-      /* a base class for messages on the queue, to hide the fact that some
-       * messages are complete messages and some are only hashes of messages.
+      /* an entry on the send queue.  It holds either a complete message, which may be shared
+       * with the queues of other peers, or only the id of the item we want to send.  For those,
+       * we make a callback to the node to generate the message when it reaches the front of the queue.
        */
       struct queued_message
       {
-        fc::time_point enqueue_time;
-        fc::time_point transmission_start_time;
-        fc::time_point transmission_finish_time;
-
-        queued_message(fc::time_point enqueue_time = fc::time_point::now()) :
-          enqueue_time(enqueue_time)
-        {}
-
-        virtual message get_message(peer_connection_delegate* node) = 0;
-        /** returns roughly the number of bytes of memory the message is consuming while
-         * it is sitting on the queue
-         */
-        virtual size_t get_size_in_queue() = 0;
-        virtual ~queued_message() {}
-      };
-
-      /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
-       */
-      struct real_queued_message : queued_message
-      {
-        message        message_to_send;
-        size_t         message_send_time_field_offset;
-
-        real_queued_message(message message_to_send,
-                            size_t message_send_time_field_offset = (size_t)-1) :
+        fc::time_point                 enqueue_time;
+        fc::time_point                 transmission_start_time;
+        fc::time_point                 transmission_finish_time;
+        std::shared_ptr<const message> message_to_send;
+        item_id                        item_to_send;
+        size_t                         message_send_time_field_offset = (size_t)-1;
+
+        queued_message() {}
+        queued_message(std::shared_ptr<const message> message_to_send,
+                       size_t message_send_time_field_offset = (size_t)-1) :
+          enqueue_time(fc::time_point::now()),
           message_to_send(std::move(message_to_send)),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
-
-        message get_message(peer_connection_delegate* node) override;
-        size_t get_size_in_queue() override;
-      };
-
-      /* when you queue up a 'virtual_queued_message', we just queue up the hash of the
-       * item we want to send.  When it reaches the top of the queue, we make a callback
-       * to the node to generate the message.
-       */
-      struct virtual_queued_message : queued_message
-      {
-        item_id item_to_send;
-
-        virtual_queued_message(item_id item_to_send) :
+        explicit queued_message(item_id item_to_send) :
+          enqueue_time(fc::time_point::now()),
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
-        size_t get_size_in_queue() override;
+        /** returns the message to put on the wire, generating it if only the item id was queued */
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) const;
+        /** returns roughly the number of bytes of memory the message is consuming while
+         * it is sitting on the queue
+         */
+        size_t get_size_in_queue() const;
       };
 
-
       size_t _total_queued_messages_size = 0;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      size_t _max_queued_messages_count = 0;
+      boost::circular_buffer<queued_message> _queued_messages;
       fc::future<void> _send_queued_messages_done;
     public:
       fc::time_point connection_initiation_time;
@@ -281,8 +259,10 @@ namespace graphene { namespace net
       void on_message(message_oriented_connection* originating_connection, const message& received_message) override;
       void on_connection_closed(message_oriented_connection* originating_connection) override;
 
-      void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
+      void send_queueable_message(queued_message&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      /** queues a message that is already packed, without copying it; use this for messages sent to many peers */
+      void send_shared_message(std::shared_ptr<const message> message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -290,6 +270,13 @@ namespace graphene { namespace net
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
 
+      /// send queue depth, in messages and in bytes, and the largest number of messages it ever held
+      /// @{
+      size_t get_queued_messages_count() const { return _queued_messages.size(); }
+      size_t get_queued_messages_size() const { return _total_queued_messages_size; }
+      size_t get_max_queued_messages_count() const { return _max_queued_messages_count; }
+      /// @}
+
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
 
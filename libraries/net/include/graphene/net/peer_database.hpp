@@ -26,6 +26,7 @@
 
 #include <graphene/chain/protocol/types.hpp>
 
+#include <fc/filesystem.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/time.hpp>
 #include <fc/io/enum_type.hpp>
@@ -99,7 +100,8 @@ namespace graphene { namespace net {
     peer_database();
     ~peer_database();
 
-    void open(const fc::path& databaseFilename);
+    /** loads the database, importing the peers from legacyJsonFilename if databaseFilename doesn't exist yet */
+    void open(const fc::path& databaseFilename, const fc::path& legacyJsonFilename = fc::path());
     void close();
     void clear();
 
@@ -112,6 +114,9 @@ namespace graphene { namespace net {
     typedef detail::peer_database_iterator iterator;
     iterator begin() const;
     iterator end() const;
+    /** iterates the peers with the fewest failed connection attempts first, most recently seen first among equals */
+    iterator begin_connection_candidates() const;
+    iterator end_connection_candidates() const;
     size_t size() const;
   private:
     std::unique_ptr<detail::peer_database_impl> my;
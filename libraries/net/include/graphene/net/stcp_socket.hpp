@@ -35,6 +35,11 @@ namespace graphene { namespace net {
 class stcp_socket : public virtual fc::iostream
 {
   public:
+    /** largest chunk encrypted or decrypted at once, and the size of the reusable cipher buffers */
+    static const size_t buffer_size = 64 * 1024;
+    /** chunks at least this large are run through the cipher on a shared worker thread when offload is enabled */
+    static const size_t cipher_offload_threshold = 16 * 1024;
+
     stcp_socket();
     ~stcp_socket();
     fc::tcp_socket&  get_socket() { return _sock; }
@@ -56,6 +61,13 @@ class stcp_socket : public virtual fc::iostream
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
+
+    /**
+     *  Encrypt and decrypt large chunks of all sockets on a worker thread, so the cipher work for big messages
+     *  doesn't hold up the other connections served by the calling thread.  Enabling starts the worker and
+     *  disabling quits it, which has to happen before shutting down, once no socket is in use anymore.
+     */
+    static void      enable_cipher_offload( bool enable );
   private:
     void do_key_exchange();
 
@@ -64,6 +64,10 @@ namespace graphene { namespace net {
 
       std::atomic_bool _send_message_in_progress;
       std::atomic_bool _read_loop_in_progress;
+
+      /** padded copy of the message being sent, kept between sends unless it grew past max_retained_send_buffer */
+      std::vector<char> _send_buffer;
+      static const size_t max_retained_send_buffer = 256 * 1024;
 #ifndef NDEBUG
       fc::thread* _thread;
 #endif
@@ -268,16 +272,19 @@ namespace graphene { namespace net {
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
+        _send_buffer.resize(size_with_padding);
+        char* padded_message = _send_buffer.data();
 
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        char* paddingSpace = padded_message.get() + sizeof(message_header) + message_to_send.size;
+        memcpy(padded_message, (char*)&message_to_send, sizeof(message_header));
+        memcpy(padded_message + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
+        char* paddingSpace = padded_message + sizeof(message_header) + message_to_send.size;
         size_t toClean = size_with_padding - size_of_message_and_header;
         memset(paddingSpace, 0, toClean);
 
-        _sock.write(padded_message.get(), size_with_padding);
+        _sock.write(padded_message, size_with_padding);
         _sock.flush();
+        if (_send_buffer.capacity() > max_retained_send_buffer)
+          std::vector<char>().swap(_send_buffer);
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
@@ -136,7 +136,7 @@ namespace graphene { namespace net {
       struct message_info
       {
         message_hash_type message_hash;
-        message           message_body;
+        std::shared_ptr<const message> message_body;
         uint32_t          block_clock_when_received;
 
         // for network performance stats
@@ -149,7 +149,7 @@ namespace graphene { namespace net {
                       const message_propagation_data& propagation_data,
                       fc::uint160_t            message_contents_hash ) :
           message_hash( message_hash ),
-          message_body( message_body ),
+          message_body( std::make_shared<message>( message_body ) ),
           block_clock_when_received( block_clock_when_received ),
           propagation_data( propagation_data ),
           message_contents_hash( message_contents_hash )
@@ -176,7 +176,10 @@ namespace graphene { namespace net {
       void block_accepted();
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
+      /** returns the cached message itself rather than a copy, or null if it isn't in the cache */
+      std::shared_ptr<const message> find_message( const message_hash_type& hash_of_message_to_lookup ) const;
+      /** same as find_message, but looks the message up by the hash of what it contains, e.g., the block id */
+      std::shared_ptr<const message> find_message_by_contents( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
     };
@@ -201,13 +204,25 @@ namespace graphene { namespace net {
                                          message_content_hash ) );
     }
 
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+    std::shared_ptr<const message> blockchain_tied_message_cache::find_message( const message_hash_type& hash_of_message_to_lookup ) const
     {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
       if( iter != _message_cache.get<message_hash_index>().end() )
         return iter->message_body;
-      FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
+      return std::shared_ptr<const message>();
+    }
+
+    std::shared_ptr<const message> blockchain_tied_message_cache::find_message_by_contents( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
+    {
+      if( hash_of_message_contents_to_lookup != fc::uint160_t() )
+      {
+        message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
+           _message_cache.get<message_contents_hash_index>().find(hash_of_message_contents_to_lookup );
+        if( iter != _message_cache.get<message_contents_hash_index>().end() )
+          return iter->message_body;
+      }
+      return std::shared_ptr<const message>();
     }
 
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
@@ -415,7 +430,8 @@ namespace graphene { namespace net { namespace detail {
       fc::sha256           _chain_id;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME "peers.dat"
+#define LEGACY_POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
       fc::path             _node_configuration_directory;
       node_configuration   _node_configuration;
 
@@ -751,7 +767,7 @@ namespace graphene { namespace net { namespace detail {
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      std::shared_ptr<const message> get_message_for_item(item_id item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -921,8 +937,8 @@ namespace graphene { namespace net { namespace detail {
             bool initiated_connection_this_pass = false;
             _potential_peer_database_updated = false;
 
-            for (peer_database::iterator iter = _potential_peer_db.begin();
-                 iter != _potential_peer_db.end() && is_wanting_new_connections();
+            for (peer_database::iterator iter = _potential_peer_db.begin_connection_candidates();
+                 iter != _potential_peer_db.end_connection_candidates() && is_wanting_new_connections();
                  ++iter)
             {
               fc::microseconds delay_until_retry = fc::seconds((iter->number_of_failed_connection_attempts + 1) * _peer_connection_retry_timeout);
@@ -1245,7 +1261,9 @@ namespace graphene { namespace net { namespace detail {
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
         // we're computing the messages)
-        std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > inventory_messages_to_send;
+        std::list<std::pair<peer_connection_ptr, std::shared_ptr<const message> > > inventory_messages_to_send;
+        // most peers are sent exactly the same inventory, so each distinct inventory message is packed only once
+        std::map<std::pair<uint32_t, std::vector<item_hash_t> >, std::shared_ptr<const message> > packed_inventory_messages;
 
         for (const peer_connection_ptr& peer : _active_connections)
         {
@@ -1286,14 +1304,19 @@ namespace graphene { namespace net { namespace detail {
                    ("count", total_items_to_send_to_this_peer)
                    ("types", items_to_advertise_by_type.size())
                    ("endpoint", peer->get_remote_endpoint()));
-            for (auto items_group : items_to_advertise_by_type)
-              inventory_messages_to_send.push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first, items_group.second)));
+            for (auto& items_group : items_to_advertise_by_type)
+            {
+              std::shared_ptr<const message>& packed_inventory = packed_inventory_messages[items_group];
+              if (!packed_inventory)
+                packed_inventory = std::make_shared<message>(item_ids_inventory_message(items_group.first, items_group.second));
+              inventory_messages_to_send.push_back(std::make_pair(peer, packed_inventory));
+            }
           }
           peer->clear_old_inventory();
         }
 
         for (auto iter = inventory_messages_to_send.begin(); iter != inventory_messages_to_send.end(); ++iter)
-          iter->first->send_message(iter->second);
+          iter->first->send_shared_message(iter->second);
         inventory_messages_to_send.clear();
 
         if (_new_inventory.empty())
@@ -2743,21 +2766,21 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    std::shared_ptr<const message> node_impl::get_message_for_item(item_id item)
     {
+      if (std::shared_ptr<const message> cached_message = _message_cache.find_message(item.item_hash))
+        return cached_message;
+      // blocks are requested by block id; a block we just broadcast was packed once and is shared by all peers
+      if (item.item_type == block_message_type)
+        if (std::shared_ptr<const message> cached_block = _message_cache.find_message_by_contents(item.item_hash))
+          return cached_block;
       try
       {
-        return _message_cache.get_message(item.item_hash);
-      }
-      catch (fc::key_not_found_exception&)
-      {}
-      try
-      {
-        return _delegate->get_item(item);
+        return std::make_shared<message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2768,34 +2791,31 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      std::shared_ptr<const message> last_block_message_sent;
 
-      std::list<message> reply_messages;
+      std::list<std::shared_ptr<const message> > reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
-        try
+        std::shared_ptr<const message> requested_message = _message_cache.find_message(item_hash);
+        if (requested_message)
         {
-          message requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
+               ("id", requested_message->id()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
             last_block_message_sent = requested_message;
           continue;
         }
-        catch (fc::key_not_found_exception&)
-        {
-           // it wasn't in our local cache, that's ok ask the client
-        }
+        // it wasn't in our local cache, that's ok ask the client
 
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          requested_message = std::make_shared<message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
@@ -2804,7 +2824,7 @@ namespace graphene { namespace net { namespace detail {
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2818,12 +2838,12 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (const std::shared_ptr<const message>& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply->msg_type == block_message_type)
+          originating_peer->send_item(item_id(block_message_type, reply->as<graphene::net::block_message>().block_id));
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_shared_message(reply);
       }
     }
 
@@ -4501,7 +4521,8 @@ namespace graphene { namespace net { namespace detail {
       fc::path potential_peer_database_file_name(_node_configuration_directory / POTENTIAL_PEER_DATABASE_FILENAME);
       try
       {
-        _potential_peer_db.open(potential_peer_database_file_name);
+        _potential_peer_db.open(potential_peer_database_file_name,
+                                _node_configuration_directory / LEGACY_POTENTIAL_PEER_DATABASE_FILENAME);
 
         // push back the time on all peers loaded from the database so we will be able to retry them immediately
         for (peer_database::iterator itr = _potential_peer_db.begin(); itr != _potential_peer_db.end(); ++itr)
@@ -4888,6 +4909,9 @@ namespace graphene { namespace net { namespace detail {
         peer_details["lastrecv"] = peer->get_last_message_received_time().sec_since_epoch();
         peer_details["bytessent"] = peer->get_total_bytes_sent();
         peer_details["bytesrecv"] = peer->get_total_bytes_received();
+        peer_details["send_queue_messages"] = (uint64_t)peer->get_queued_messages_count();
+        peer_details["send_queue_bytes"] = (uint64_t)peer->get_queued_messages_size();
+        peer_details["send_queue_max_messages"] = (uint64_t)peer->get_max_queued_messages_count();
         peer_details["conntime"] = peer->get_connection_time();
         peer_details["pingtime"] = "";
         peer_details["pingwait"] = "";
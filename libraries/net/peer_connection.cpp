@@ -45,37 +45,37 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    /** the send queue starts out with room for this many messages, and shrinks back to it whenever it drains */
+    static const size_t initial_send_queue_capacity = 16;
+
+    std::shared_ptr<const message> peer_connection::queued_message::get_message(peer_connection_delegate* node) const
     {
+      if (!message_to_send)
+        return node->get_message_for_item(item_to_send);
       if (message_send_time_field_offset != (size_t)-1)
       {
-        // patch the current time into the message.  Since this operates on the packed version of the structure,
+        // patch the current time into a copy of the message.  Since this operates on the packed version of the structure,
         // it won't work for anything after a variable-length field
+        std::shared_ptr<message> patched_message = std::make_shared<message>(*message_to_send);
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= patched_message->data.size());
+        memcpy(patched_message->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
+        return patched_message;
       }
       return message_to_send;
     }
-    size_t peer_connection::real_queued_message::get_size_in_queue()
-    {
-      return message_to_send.data.size();
-    }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
-    {
-      return node->get_message_for_item(item_to_send);
-    }
 
-    size_t peer_connection::virtual_queued_message::get_size_in_queue()
+    size_t peer_connection::queued_message::get_size_in_queue() const
     {
-      return sizeof(item_id);
+      return message_to_send ? message_to_send->data.size() : sizeof(item_id);
     }
 
     peer_connection::peer_connection(peer_connection_delegate* delegate) :
       _node(delegate),
       _message_connection(this),
       _total_queued_messages_size(0),
+      _queued_messages(initial_send_queue_capacity),
       direction(peer_connection_direction::unknown),
       is_firewalled(firewalled_state::unknown),
       our_state(our_connection_state::disconnected),
@@ -295,14 +295,17 @@ namespace graphene { namespace net
 #endif
       while (!_queued_messages.empty())
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        // generating and sending the message yields, and anything queued meanwhile may reallocate the queue,
+        // so work from a copy of the entry rather than a reference into the queue
+        _queued_messages.front().transmission_start_time = fc::time_point::now();
+        const queued_message front = _queued_messages.front();
+        std::shared_ptr<const message> message_to_send = front.get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          //     ("type", message_to_send->msg_type)("endpoint", get_remote_endpoint()));
+          _message_connection.send_message(*message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -332,18 +335,23 @@ namespace graphene { namespace net
         {
           wlog("message_oriented_exception::send_message() threw an unhandled exception");
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
+        _queued_messages.front().transmission_finish_time = fc::time_point::now();
+        _total_queued_messages_size -= front.get_size_in_queue();
+        _queued_messages.pop_front();
       }
+      if (_queued_messages.capacity() > initial_send_queue_capacity)
+        _queued_messages.set_capacity(initial_send_queue_capacity);
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
 
-    void peer_connection::send_queueable_message(std::unique_ptr<queued_message>&& message_to_send)
+    void peer_connection::send_queueable_message(queued_message&& message_to_send)
     {
       VERIFY_CORRECT_THREAD();
-      _total_queued_messages_size += message_to_send->get_size_in_queue();
-      _queued_messages.emplace(std::move(message_to_send));
+      _total_queued_messages_size += message_to_send.get_size_in_queue();
+      if (_queued_messages.full())
+        _queued_messages.set_capacity(_queued_messages.capacity() * 2);
+      _queued_messages.push_back(std::move(message_to_send));
+      _max_queued_messages_count = std::max(_max_queued_messages_count, _queued_messages.size());
       if (_total_queued_messages_size > GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         wlog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -376,8 +384,13 @@ namespace graphene { namespace net
       VERIFY_CORRECT_THREAD();
       //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send, message_send_time_field_offset));
-      send_queueable_message(std::move(message_to_enqueue));
+      send_queueable_message(queued_message(std::make_shared<message>(message_to_send), message_send_time_field_offset));
+    }
+
+    void peer_connection::send_shared_message(std::shared_ptr<const message> message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      send_queueable_message(queued_message(std::move(message_to_send)));
     }
 
     void peer_connection::send_item(const item_id& item_to_send)
@@ -385,8 +398,7 @@ namespace graphene { namespace net
       VERIFY_CORRECT_THREAD();
       //dlog("peer_connection::send_item() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", item_to_send.item_type)("endpoint", get_remote_endpoint()));
-      std::unique_ptr<queued_message> message_to_enqueue(new virtual_queued_message(item_to_send));
-      send_queueable_message(std::move(message_to_enqueue));
+      send_queueable_message(queued_message(item_to_send));
     }
 
     void peer_connection::close_connection()
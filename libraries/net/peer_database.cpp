@@ -27,12 +27,16 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/tag.hpp>
+#include <boost/multi_index/composite_key.hpp>
 
 #include <fc/io/raw.hpp>
 #include <fc/io/raw_variant.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
 
+#include <fstream>
+
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/config.hpp>
 
@@ -46,23 +50,51 @@ namespace graphene { namespace net {
     public:
       struct last_seen_time_index {};
       struct endpoint_index {};
+      struct connection_preference_index {};
       typedef boost::multi_index_container<potential_peer_record, 
                                            indexed_by<ordered_non_unique<tag<last_seen_time_index>, 
                                                                          member<potential_peer_record, 
                                                                                 fc::time_point_sec, 
-                                                                                &potential_peer_record::last_seen_time> >,
+                                                                                &potential_peer_record::last_seen_time>,
+                                                                         std::greater<fc::time_point_sec> >,
                                                       hashed_unique<tag<endpoint_index>, 
                                                                     member<potential_peer_record, 
                                                                            fc::ip::endpoint, 
                                                                            &potential_peer_record::endpoint>, 
-                                                                    std::hash<fc::ip::endpoint> > > > potential_peer_set;
+                                                                    std::hash<fc::ip::endpoint> >,
+                                                      ordered_non_unique<tag<connection_preference_index>,
+                                                                         composite_key<potential_peer_record,
+                                                                                       member<potential_peer_record,
+                                                                                              uint32_t,
+                                                                                              &potential_peer_record::number_of_failed_connection_attempts>,
+                                                                                       member<potential_peer_record,
+                                                                                              fc::time_point_sec,
+                                                                                              &potential_peer_record::last_seen_time> >,
+                                                                         composite_key_compare<std::less<uint32_t>,
+                                                                                               std::greater<fc::time_point_sec> > > > > potential_peer_set;
 
     private:
+      /** entries in the peer database file, each one a tag byte followed by the packed record or endpoint */
+      enum log_entry_type : uint8_t
+      {
+        log_entry_update = 0,
+        log_entry_erase = 1
+      };
+
       potential_peer_set     _potential_peer_set;
       fc::path _peer_database_filename;
+      std::ofstream _log;
+      /// number of entries in the file, the file is rewritten once it holds too many superseded ones
+      size_t _log_entry_count = 0;
+
+      void load(const fc::path& filename);
+      void import_json(const fc::path& filename);
+      void compact();
+      void append_to_log(log_entry_type type, const std::vector<char>& packed_value);
+      void insert_bounded(const potential_peer_record& record);
 
     public:
-      void open(const fc::path& databaseFilename);
+      void open(const fc::path& databaseFilename, const fc::path& legacy_json_filename);
       void close();
       void clear();
       void erase(const fc::ip::endpoint& endpointToErase);
@@ -72,63 +104,222 @@ namespace graphene { namespace net {
 
       peer_database::iterator begin() const;
       peer_database::iterator end() const;
+      peer_database::iterator begin_connection_candidates() const;
+      peer_database::iterator end_connection_candidates() const;
       size_t size() const;
     };
 
     class peer_database_iterator_impl
     {
     public:
-      typedef peer_database_impl::potential_peer_set::index<peer_database_impl::last_seen_time_index>::type::iterator last_seen_time_index_iterator;
-      last_seen_time_index_iterator _iterator;
-      explicit peer_database_iterator_impl(const last_seen_time_index_iterator& iterator) :
+      virtual ~peer_database_iterator_impl() {}
+      virtual void increment() = 0;
+      virtual bool equal(const peer_database_iterator_impl& other) const = 0;
+      virtual const potential_peer_record& dereference() const = 0;
+    };
+
+    template<typename IndexIterator>
+    class peer_database_index_iterator_impl : public peer_database_iterator_impl
+    {
+    public:
+      IndexIterator _iterator;
+      explicit peer_database_index_iterator_impl(const IndexIterator& iterator) :
         _iterator(iterator)
       {}
+      void increment() override { ++_iterator; }
+      bool equal(const peer_database_iterator_impl& other) const override
+      {
+        return _iterator == static_cast<const peer_database_index_iterator_impl&>(other)._iterator;
+      }
+      const potential_peer_record& dereference() const override { return *_iterator; }
     };
+
+    template<typename IndexIterator>
+    peer_database::iterator make_peer_database_iterator(const IndexIterator& iterator)
+    {
+      return peer_database::iterator(new peer_database_index_iterator_impl<IndexIterator>(iterator));
+    }
+
+    /** the file is compacted once it holds this many entries more than there are peers */
+    const size_t MAXIMUM_SUPERSEDED_PEERDB_ENTRIES = MAXIMUM_PEERDB_SIZE;
     peer_database_iterator::peer_database_iterator( const peer_database_iterator& c ) :
       boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c){}
 
-    void peer_database_impl::open(const fc::path& peer_database_filename)
+    void peer_database_impl::open(const fc::path& peer_database_filename, const fc::path& legacy_json_filename)
     {
       _peer_database_filename = peer_database_filename;
       if (fc::exists(_peer_database_filename))
+        load(_peer_database_filename);
+      else if (fc::exists(legacy_json_filename))
+        import_json(legacy_json_filename);
+
+      if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
       {
-        try
+        // prune database to a reasonable size, keeping the most recently seen peers
+        auto iter = _potential_peer_set.begin();
+        std::advance(iter, MAXIMUM_PEERDB_SIZE);
+        _potential_peer_set.erase(iter, _potential_peer_set.end());
+      }
+
+      try
+      {
+        compact();
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error writing peer database file ${peer_database_filename}: ${e}",
+             ("peer_database_filename", _peer_database_filename)("e", e.to_detail_string()));
+      }
+    }
+
+    void peer_database_impl::load(const fc::path& filename)
+    {
+      std::string contents;
+      try
+      {
+        fc::read_file_contents(filename, contents);
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error opening peer database file ${peer_database_filename}, starting with a clean database",
+             ("peer_database_filename", filename));
+        return;
+      }
+
+      fc::datastream<const char*> ds(contents.data(), contents.size());
+      try
+      {
+        while (ds.remaining())
         {
-          std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
-          std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-          if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
+          uint8_t type;
+          fc::raw::unpack(ds, type);
+          if (type == log_entry_update)
           {
-            // prune database to a reasonable size
-            auto iter = _potential_peer_set.begin();
-            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-            _potential_peer_set.erase(iter, _potential_peer_set.end());
+            potential_peer_record record;
+            fc::raw::unpack(ds, record, GRAPHENE_NET_MAX_NESTED_OBJECTS);
+            auto iter = _potential_peer_set.get<endpoint_index>().find(record.endpoint);
+            if (iter != _potential_peer_set.get<endpoint_index>().end())
+              _potential_peer_set.get<endpoint_index>().replace(iter, record);
+            else
+              _potential_peer_set.insert(record);
           }
+          else if (type == log_entry_erase)
+          {
+            fc::ip::endpoint endpoint;
+            fc::raw::unpack(ds, endpoint);
+            _potential_peer_set.get<endpoint_index>().erase(endpoint);
+          }
+          else
+            FC_THROW("unknown peer database entry type ${type}", ("type", type));
         }
-        catch (const fc::exception& e)
-        {
-          elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
-               ("peer_database_filename", _peer_database_filename));
-        }
+      }
+      catch (const fc::exception& e)
+      {
+        // most likely the tail of an entry that was being written when the node stopped
+        wlog("ignoring damaged tail of peer database file ${peer_database_filename} after ${n} bytes",
+             ("peer_database_filename", filename)("n", contents.size() - ds.remaining()));
       }
     }
 
-    void peer_database_impl::close()
+    void peer_database_impl::import_json(const fc::path& filename)
     {
-      std::vector<potential_peer_record> peer_records;
-      peer_records.reserve(_potential_peer_set.size());
-      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
-
       try
       {
-        fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
-        if (!fc::exists(peer_database_filename_dir))
-          fc::create_directories(peer_database_filename_dir);
-        fc::json::save_to_file( peer_records, _peer_database_filename, GRAPHENE_NET_MAX_NESTED_OBJECTS );
+        std::vector<potential_peer_record> peer_records = fc::json::from_file(filename).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
+        std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
+        ilog("imported ${n} peers from ${filename}", ("n", _potential_peer_set.size())("filename", filename));
       }
       catch (const fc::exception& e)
       {
-        elog("error saving peer database to file ${peer_database_filename}", 
-             ("peer_database_filename", _peer_database_filename));
+        elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
+             ("peer_database_filename", filename));
+      }
+    }
+
+    void peer_database_impl::compact()
+    {
+      if (_log.is_open())
+        _log.close();
+
+      fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
+      if (!fc::exists(peer_database_filename_dir))
+        fc::create_directories(peer_database_filename_dir);
+
+      fc::path temp_filename(_peer_database_filename.generic_string() + ".tmp");
+      {
+        std::ofstream out(temp_filename.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        for (const potential_peer_record& record : _potential_peer_set)
+        {
+          const uint8_t type = log_entry_update;
+          out.write((const char*)&type, sizeof(type));
+          std::vector<char> packed_record = fc::raw::pack(record);
+          out.write(packed_record.data(), packed_record.size());
+        }
+        FC_ASSERT(out.good(), "unable to write ${filename}", ("filename", temp_filename));
+      }
+      fc::rename(temp_filename, _peer_database_filename);
+      _log_entry_count = _potential_peer_set.size();
+
+      _log.open(_peer_database_filename.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app);
+    }
+
+    void peer_database_impl::append_to_log(log_entry_type type, const std::vector<char>& packed_value)
+    {
+      if (!_log.is_open())
+        return;
+      if (_log_entry_count >= _potential_peer_set.size() + MAXIMUM_SUPERSEDED_PEERDB_ENTRIES)
+      {
+        try
+        {
+          compact();
+          return;
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error compacting peer database file ${peer_database_filename}: ${e}",
+               ("peer_database_filename", _peer_database_filename)("e", e.to_detail_string()));
+          if (!_log.is_open())
+            return;
+        }
+      }
+      const uint8_t tag = type;
+      _log.write((const char*)&tag, sizeof(tag));
+      _log.write(packed_value.data(), packed_value.size());
+      // hand every entry to the OS right away, so a crash loses nothing that was appended
+      _log.flush();
+      ++_log_entry_count;
+    }
+
+    void peer_database_impl::insert_bounded(const potential_peer_record& record)
+    {
+      _potential_peer_set.insert(record);
+      if (_potential_peer_set.size() <= MAXIMUM_PEERDB_SIZE)
+        return;
+
+      // evict the peer we've heard from least recently, unless that is the one just added
+      auto& last_seen_idx = _potential_peer_set.get<last_seen_time_index>();
+      auto stalest = std::prev(last_seen_idx.end());
+      if (stalest->endpoint == record.endpoint)
+        --stalest;
+      fc::ip::endpoint evicted = stalest->endpoint;
+      last_seen_idx.erase(stalest);
+      append_to_log(log_entry_erase, fc::raw::pack(evicted));
+    }
+
+    void peer_database_impl::close()
+    {
+      if (_log.is_open())
+      {
+        try
+        {
+          compact();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error saving peer database to file ${peer_database_filename}", 
+               ("peer_database_filename", _peer_database_filename));
+        }
+        _log.close();
       }
       _potential_peer_set.clear();
     }
@@ -136,13 +327,28 @@ namespace graphene { namespace net {
     void peer_database_impl::clear()
     {
       _potential_peer_set.clear();
+      if (_log.is_open())
+      {
+        try
+        {
+          compact();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error clearing peer database file ${peer_database_filename}",
+               ("peer_database_filename", _peer_database_filename));
+        }
+      }
     }
 
     void peer_database_impl::erase(const fc::ip::endpoint& endpointToErase)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
+      {
         _potential_peer_set.get<endpoint_index>().erase(iter);
+        append_to_log(log_entry_erase, fc::raw::pack(endpointToErase));
+      }
     }
 
     void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
@@ -151,7 +357,8 @@ namespace graphene { namespace net {
       if (iter != _potential_peer_set.get<endpoint_index>().end())
         _potential_peer_set.get<endpoint_index>().modify(iter, [&updatedRecord](potential_peer_record& record) { record = updatedRecord; });
       else
-        _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
+        insert_bounded(updatedRecord);
+      append_to_log(log_entry_update, fc::raw::pack(updatedRecord));
     }
 
     potential_peer_record peer_database_impl::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)
@@ -172,12 +379,22 @@ namespace graphene { namespace net {
 
     peer_database::iterator peer_database_impl::begin() const
     {
-      return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().begin()));
+      return make_peer_database_iterator(_potential_peer_set.get<last_seen_time_index>().begin());
     }
 
     peer_database::iterator peer_database_impl::end() const
     {
-      return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().end()));
+      return make_peer_database_iterator(_potential_peer_set.get<last_seen_time_index>().end());
+    }
+
+    peer_database::iterator peer_database_impl::begin_connection_candidates() const
+    {
+      return make_peer_database_iterator(_potential_peer_set.get<connection_preference_index>().begin());
+    }
+
+    peer_database::iterator peer_database_impl::end_connection_candidates() const
+    {
+      return make_peer_database_iterator(_potential_peer_set.get<connection_preference_index>().end());
     }
 
     size_t peer_database_impl::size() const
@@ -200,17 +417,17 @@ namespace graphene { namespace net {
 
     void peer_database_iterator::increment()
     {
-      ++my->_iterator;
+      my->increment();
     }
 
     bool peer_database_iterator::equal(const peer_database_iterator& other) const
     {
-      return my->_iterator == other.my->_iterator;
+      return my->equal(*other.my);
     }
 
     const potential_peer_record& peer_database_iterator::dereference() const
     {
-      return *my->_iterator;
+      return my->dereference();
     }
 
   } // end namespace detail
@@ -223,9 +440,9 @@ namespace graphene { namespace net {
   peer_database::~peer_database()
   {}
 
-  void peer_database::open(const fc::path& databaseFilename)
+  void peer_database::open(const fc::path& databaseFilename, const fc::path& legacyJsonFilename)
   {
-    my->open(databaseFilename);
+    my->open(databaseFilename, legacyJsonFilename);
   }
 
   void peer_database::close()
@@ -268,6 +485,16 @@ namespace graphene { namespace net {
     return my->end();
   }
 
+  peer_database::iterator peer_database::begin_connection_candidates() const
+  {
+    return my->begin_connection_candidates();
+  }
+
+  peer_database::iterator peer_database::end_connection_candidates() const
+  {
+    return my->end_connection_candidates();
+  }
+
   size_t peer_database::size() const
   {
     return my->size();
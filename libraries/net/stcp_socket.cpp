@@ -24,6 +24,7 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <memory>
 
 #include <fc/crypto/hex.hpp>
 #include <fc/crypto/aes.hpp>
@@ -31,11 +32,49 @@
 #include <fc/log/logger.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <graphene/net/stcp_socket.hpp>
 
 namespace graphene { namespace net {
 
+const size_t stcp_socket::buffer_size;
+const size_t stcp_socket::cipher_offload_threshold;
+
+namespace {
+
+/** the shared cipher thread, only exists while offload is enabled */
+std::shared_ptr<fc::thread> cipher_thread;
+
+/** runs the cipher call f for a chunk of len bytes, on the shared cipher thread if that is worth it */
+template<typename Functor>
+uint32_t run_cipher( size_t len, Functor&& f )
+{
+  if( len < stcp_socket::cipher_offload_threshold )
+    return f();
+  std::shared_ptr<fc::thread> worker = std::atomic_load( &cipher_thread );
+  if( !worker )
+    return f();
+  return worker->async( std::forward<Functor>(f), "stcp cipher" ).wait();
+}
+
+} // anonymous namespace
+
+void stcp_socket::enable_cipher_offload( bool enable )
+{
+  if( enable )
+  {
+    std::shared_ptr<fc::thread> none;
+    std::atomic_compare_exchange_strong( &cipher_thread, &none, std::make_shared<fc::thread>( "stcp_cipher" ) );
+  }
+  else
+  {
+    std::shared_ptr<fc::thread> worker = std::atomic_exchange( &cipher_thread, std::shared_ptr<fc::thread>() );
+    if( worker )
+      worker->quit();
+  }
+}
+
 stcp_socket::stcp_socket()
 //:_buf_len(0)
 #ifndef NDEBUG
@@ -100,11 +139,10 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
     if (!_read_buffer)
-      _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
+      _read_buffer.reset(new char[buffer_size], [](char* p){ delete[] p; });
 
-    len = std::min<size_t>(read_buffer_length, len);
+    len = std::min<size_t>(buffer_size, len);
 
     size_t s = _sock.readsome( _read_buffer, len, 0 );
     if( s % 16 ) 
@@ -112,7 +150,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
       _sock.read(_read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    run_cipher( s, [&]() { return _recv_aes.decode( _read_buffer.get(), s, buffer ); } );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -141,18 +179,16 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
     if (!_write_buffer)
-      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
-    len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
+      _write_buffer.reset(new char[buffer_size], [](char* p){ delete[] p; });
+    len = std::min<size_t>(buffer_size, len);
     /**
      * every sizeof(crypt_buf) bytes the aes channel
      * has an error and doesn't decrypt properly...  disable
      * for now because we are going to upgrade to something
      * better.
      */
-    uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
+    uint32_t ciphertext_len = run_cipher( len, [&]() { return _send_aes.encode( buffer, len, _write_buffer.get() ); } );
     assert(ciphertext_len == len);
     _sock.write( _write_buffer, ciphertext_len );
     return ciphertext_len;
@@ -92,8 +92,9 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
          _oho_index->use_next_id();
    };
 
-   for( optional< operation_history_object >& o_op : hist )
+   for( size_t op_index = 0; op_index < hist.size(); ++op_index )
    {
+      optional< operation_history_object >& o_op = hist[op_index];
       optional<operation_history_object> oho;
 
       auto create_oho = [&]() {
@@ -121,26 +122,19 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       const operation_history_object& op = *o_op;
 
       // get the set of accounts this operation applies to
-      flat_set<account_id_type> impacted;
-      vector<authority> other;
-      operation_get_required_authorities( op.op, impacted, impacted, other ); // fee_payer is added here
-
-      if( op.op.which() == operation::tag< account_create_operation >::value )
-         impacted.insert( op.result.get<object_id_type>() );
-      else
-         graphene::chain::operation_get_impacted_accounts( op.op, impacted );
+      flat_set<account_id_type> lottery_impacted;
       if( op.op.which() == operation::tag< lottery_end_operation >::value )
       {
+         lottery_impacted = db.get_applied_operation_impacted_accounts( op_index );
          auto lop = op.op.get< lottery_end_operation >();
          auto asset_object = lop.lottery( db );
-         impacted.insert( asset_object.issuer );
+         lottery_impacted.insert( asset_object.issuer );
          for( auto benefactor : asset_object.lottery_options->benefactors )
-            impacted.insert( benefactor.id );
+            lottery_impacted.insert( benefactor.id );
       }
-
-      for( auto& a : other )
-         for( auto& item : a.account_auths )
-            impacted.insert( item.first );
+      const flat_set<account_id_type>& impacted = lottery_impacted.empty()
+                                                  ? db.get_applied_operation_impacted_accounts( op_index )
+                                                  : lottery_impacted;
 
       // be here, either _max_ops_per_account > 0, or _partial_operations == false, or both
       // if _partial_operations == false, oho should have been created above
@@ -66,7 +66,7 @@ bookie_api_impl::bookie_api_impl(graphene::app::application& _app) : app(_app)
 binned_order_book bookie_api_impl::get_binned_order_book(graphene::chain::betting_market_id_type betting_market_id, int32_t precision)
 {
     std::shared_ptr<graphene::chain::database> db = app.chain_database();
-    const auto& bet_odds_idx = db->get_index_type<graphene::chain::bet_object_index>().indices().get<graphene::chain::by_odds>();
+    const auto& price_levels = db->get_index_type<graphene::db::primary_index<graphene::chain::bet_object_index>>().get_secondary_index<graphene::chain::bet_price_level_index>();
     const chain_parameters& current_params = db->get_global_properties().parameters;
 
     graphene::chain::bet_multiplier_type bin_size = GRAPHENE_BETTING_ODDS_PRECISION;
@@ -104,33 +104,30 @@ binned_order_book bookie_api_impl::get_binned_order_book(graphene::chain::bettin
         }
     };
 
-    // iterate through both sides of the order book (backs at increasing odds then lays at decreasing odds)
-    for (auto bet_odds_iter = bet_odds_idx.lower_bound(std::make_tuple(betting_market_id));
-         bet_odds_iter != bet_odds_idx.end() && betting_market_id == bet_odds_iter->betting_market_id;
-         ++bet_odds_iter)
+    auto add_price_level = [&](bet_type back_or_lay, graphene::chain::bet_multiplier_type backer_multiplier, share_type amount_to_bet)
     {
         if (current_bin && 
-            (bet_odds_iter->back_or_lay != current_bin->back_or_lay /* we have switched from back to lay bets */ ||
-             (bet_odds_iter->back_or_lay == bet_type::back ? bet_odds_iter->backer_multiplier > current_bin->backer_multiplier :
-                                                             bet_odds_iter->backer_multiplier < current_bin->backer_multiplier)))
+            (back_or_lay != current_bin->back_or_lay /* we have switched from back to lay bets */ ||
+             (back_or_lay == bet_type::back ? backer_multiplier > current_bin->backer_multiplier :
+                                              backer_multiplier < current_bin->backer_multiplier)))
             flush_current_bin();
 
         if (!current_bin)
         {
-            // if there is no current bin, create one appropriate for the bet we're processing
+            // if there is no current bin, create one appropriate for the level we're processing
             current_bin = graphene::chain::bet_object();
 
             // for back bets, we want to group all bets with odds from 3.0001 to 4 into the "4" bin
             // for lay bets, we want to group all bets with odds from 3 to 3.9999 into the "3" bin
-            if (bet_odds_iter->back_or_lay == bet_type::back)
+            if (back_or_lay == bet_type::back)
             {
-               current_bin->backer_multiplier = (bet_odds_iter->backer_multiplier + bin_size - 1) / bin_size * bin_size;
+               current_bin->backer_multiplier = (backer_multiplier + bin_size - 1) / bin_size * bin_size;
                current_bin->backer_multiplier = std::min<graphene::chain::bet_multiplier_type>(current_bin->backer_multiplier, current_params.max_bet_multiplier());
                current_bin->back_or_lay = bet_type::back;
             }
             else
             {
-               current_bin->backer_multiplier = bet_odds_iter->backer_multiplier / bin_size * bin_size;
+               current_bin->backer_multiplier = backer_multiplier / bin_size * bin_size;
                current_bin->backer_multiplier = std::max<graphene::chain::bet_multiplier_type>(current_bin->backer_multiplier, current_params.min_bet_multiplier());
                current_bin->back_or_lay = bet_type::lay;
             }
@@ -138,8 +135,17 @@ binned_order_book bookie_api_impl::get_binned_order_book(graphene::chain::bettin
             current_bin->amount_to_bet.amount = 0;
         }
 
-        current_bin->amount_to_bet.amount += bet_odds_iter->amount_to_bet.amount;
-    }
+        current_bin->amount_to_bet.amount += amount_to_bet;
+    };
+
+    // walk both sides of the order book a price level at a time (backs at increasing odds then lays at decreasing odds)
+    if (const auto* back_levels = price_levels.get_levels(betting_market_id, bet_type::back))
+        for (const auto& level : *back_levels)
+            add_price_level(bet_type::back, level.first, level.second.amount_to_bet);
+    if (const auto* lay_levels = price_levels.get_levels(betting_market_id, bet_type::lay))
+        for (auto level = lay_levels->rbegin(); level != lay_levels->rend(); ++level)
+            add_price_level(bet_type::lay, level->first, level->second.amount_to_bet);
+
     if (current_bin)
         flush_current_bin();
 
@@ -41,6 +41,10 @@
 
 #include <boost/polymorphic_cast.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
 #if 0
 # ifdef DEFAULT_LOGGER
 #  undef DEFAULT_LOGGER
@@ -165,26 +169,148 @@ void persistent_betting_market_group_object_helper::object_modified(const object
 }
 
 //////////// end betting_market_group_object ///////////////////
+/* The event names of one language, lower-cased once when they are indexed.  Each trigram (three consecutive
+ * bytes) of a name maps to the events whose name contains it, so a substring search only checks the events
+ * whose name contains every trigram of the substring.
+ */
+class event_name_index
+{
+   public:
+      /// adds the name of the event, replacing its previous one
+      void insert(event_id_type event_id, const std::string& name);
+      void remove(event_id_type event_id);
+
+      /// @return the events whose name contains lower_case_sub_string, ordered by id
+      std::vector<event_id_type> find(const std::string& lower_case_sub_string) const;
+
+   private:
+      typedef uint32_t trigram;
+      static std::vector<trigram> get_trigrams(const std::string& lower_case_string);
+
+      std::map<event_id_type, std::string> _lower_case_names;
+      std::unordered_map<trigram, flat_set<event_id_type> > _events_by_trigram;
+};
+
+std::vector<event_name_index::trigram> event_name_index::get_trigrams(const std::string& lower_case_string)
+{
+   std::vector<trigram> trigrams;
+   for (size_t i = 0; i + 3 <= lower_case_string.size(); ++i)
+      trigrams.push_back((uint32_t(uint8_t(lower_case_string[i])) << 16) |
+                         (uint32_t(uint8_t(lower_case_string[i + 1])) << 8) |
+                          uint32_t(uint8_t(lower_case_string[i + 2])));
+   std::sort(trigrams.begin(), trigrams.end());
+   trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+   return trigrams;
+}
+
+void event_name_index::insert(event_id_type event_id, const std::string& name)
+{
+   remove(event_id);
+   const std::string& lower_case_name = _lower_case_names[event_id] = boost::algorithm::to_lower_copy(name);
+   for (trigram t : get_trigrams(lower_case_name))
+      _events_by_trigram[t].insert(event_id);
+}
+
+void event_name_index::remove(event_id_type event_id)
+{
+   auto name_iter = _lower_case_names.find(event_id);
+   if (name_iter == _lower_case_names.end())
+      return;
+   for (trigram t : get_trigrams(name_iter->second))
+   {
+      auto events_iter = _events_by_trigram.find(t);
+      events_iter->second.erase(event_id);
+      if (events_iter->second.empty())
+         _events_by_trigram.erase(events_iter);
+   }
+   _lower_case_names.erase(name_iter);
+}
+
+std::vector<event_id_type> event_name_index::find(const std::string& lower_case_sub_string) const
+{
+   std::vector<event_id_type> events;
+   if (lower_case_sub_string.size() < 3)
+   {
+      // too short to have a trigram, check every name
+      for (const auto& name : _lower_case_names)
+         if (name.second.find(lower_case_sub_string) != std::string::npos)
+            events.push_back(name.first);
+      return events;
+   }
+
+   // intersect the events of each trigram, starting with the trigram fewest events contain
+   std::vector<const flat_set<event_id_type>*> trigram_events;
+   for (trigram t : get_trigrams(lower_case_sub_string))
+   {
+      auto events_iter = _events_by_trigram.find(t);
+      if (events_iter == _events_by_trigram.end())
+         return events;
+      trigram_events.push_back(&events_iter->second);
+   }
+   std::sort(trigram_events.begin(), trigram_events.end(),
+             [](const flat_set<event_id_type>* a, const flat_set<event_id_type>* b) { return a->size() < b->size(); });
+
+   std::vector<event_id_type> candidates(trigram_events.front()->begin(), trigram_events.front()->end());
+   for (size_t i = 1; i < trigram_events.size() && !candidates.empty(); ++i)
+   {
+      std::vector<event_id_type> remaining;
+      std::set_intersection(candidates.begin(), candidates.end(),
+                            trigram_events[i]->begin(), trigram_events[i]->end(),
+                            std::back_inserter(remaining));
+      candidates.swap(remaining);
+   }
+
+   // the trigrams may be in a different order in the name
+   for (event_id_type event_id : candidates)
+      if (_lower_case_names.at(event_id).find(lower_case_sub_string) != std::string::npos)
+         events.push_back(event_id);
+   return events;
+}
+
 class persistent_event_object_helper : public secondary_index
 {
    public:
       virtual ~persistent_event_object_helper() {}
 
       virtual void object_inserted(const object& obj) override;
-      //virtual void object_removed( const object& obj ) override;
-      //virtual void about_to_modify( const object& before ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
       virtual void object_modified(const object& after) override;
       void set_plugin_instance(bookie_plugin* instance) { _bookie_plugin = instance; }
+
+      /// adds the names of the event to the index of their language
+      void index_event_names(const event_object& event_obj);
+      //       "en"
+      const std::map<std::string, event_name_index>& localized_event_names() const { return _localized_event_names; }
    private:
       bookie_plugin* _bookie_plugin;
+      std::map<std::string, event_name_index> _localized_event_names;
+      internationalized_string_type _names_before_modify;
 };
 
+void persistent_event_object_helper::index_event_names(const event_object& event_obj)
+{
+   for (const std::pair<std::string, std::string>& pair : event_obj.name)
+      _localized_event_names[pair.first].insert(event_obj.id, pair.second);
+}
+
 void persistent_event_object_helper::object_inserted(const object& obj) 
 {
    const event_object& event_obj = *boost::polymorphic_downcast<const event_object*>(&obj);
    _bookie_plugin->database().create<persistent_event_object>([&](persistent_event_object& saved_event_obj) {
       saved_event_obj.ephemeral_event_object = event_obj;
    });
+   index_event_names(event_obj);
+}
+void persistent_event_object_helper::object_removed(const object& obj)
+{
+   // removed events, including the ones created by a pending transaction that is undone, are no longer found
+   for (auto& language : _localized_event_names)
+      language.second.remove(obj.id);
+}
+void persistent_event_object_helper::about_to_modify(const object& before)
+{
+   _names_before_modify = boost::polymorphic_downcast<const event_object*>(&before)->name;
 }
 void persistent_event_object_helper::object_modified(const object& after) 
 {
@@ -197,6 +323,14 @@ void persistent_event_object_helper::object_modified(const object& after)
       db.modify(*iter, [&](persistent_event_object& saved_event_obj) {
          saved_event_obj.ephemeral_event_object = event_obj;
       });
+
+   // most modifications change the status or the scores, only reindex when the names changed
+   if (event_obj.name != _names_before_modify)
+   {
+      for (const auto& pair : _names_before_modify)
+         _localized_event_names[pair.first].remove(event_obj.id);
+      index_event_names(event_obj);
+   }
 }
 
 //////////// end event_object ///////////////////
@@ -234,19 +368,8 @@ class bookie_plugin_impl
          return _self.database();
       }
 
-      //                1.18.          "Washington Capitals/Chicago Blackhawks"
-      typedef std::pair<event_id_type, std::string> event_string;
-      struct event_string_less : public std::less<const event_string&>
-      {
-          bool operator()(const event_string &_left, const event_string &_right) const
-          {
-              return (_left.first.instance < _right.first.instance);
-          }
-      };
-
-      typedef flat_set<event_string, event_string_less> event_string_set;
-      //       "en"
-      std::map<std::string, event_string_set> localized_event_strings;
+      // keeps the localized event names searchable
+      persistent_event_object_helper* _event_helper = nullptr;
 
       bookie_plugin& _self;
       flat_set<account_id_type> _tracked_accounts;
@@ -336,32 +459,6 @@ void bookie_plugin_impl::on_block_applied( const signed_block& )
                });
          }
       }
-      else if( op.op.which() == operation::tag<event_create_operation>::value )
-      {
-         FC_ASSERT(op.result.which() == operation_result::tag<object_id_type>::value);
-         //object_id_type object_id = op.result.get<object_id_type>();
-         event_id_type object_id = op.result.get<object_id_type>();
-         FC_ASSERT( db.find_object(object_id), "invalid event specified" );
-         const event_create_operation& event_create_op = op.op.get<event_create_operation>();
-         for(const std::pair<std::string, std::string>& pair : event_create_op.name)
-            localized_event_strings[pair.first].insert(event_string(object_id, pair.second));
-      }
-      else if( op.op.which() == operation::tag<event_update_operation>::value )
-      {
-         const event_update_operation& event_create_op = op.op.get<event_update_operation>();
-         if (!event_create_op.new_name.valid())
-            continue;
-         event_id_type event_id = event_create_op.event_id;
-         for(const std::pair<std::string, std::string>& pair : *event_create_op.new_name)
-         {
-            // try insert
-            std::pair<event_string_set::iterator, bool> result =
-               localized_event_strings[pair.first].insert(event_string(event_id, pair.second));
-            if (!result.second)
-               //  update string only
-               result.first->second = pair.second;
-         }
-      }
       else if ( op.op.which() == operation::tag<bet_canceled_operation>::value )
       {
          const bet_canceled_operation& bet_canceled_op = op.op.get<bet_canceled_operation>();
@@ -400,33 +497,26 @@ void bookie_plugin_impl::on_block_applied( const signed_block& )
 
 void bookie_plugin_impl::fill_localized_event_strings()
 {
+       // events loaded before the helper was added, the helper keeps the names up to date from here on
        graphene::chain::database& db = database();
        const auto& event_index = db.get_index_type<event_object_index>().indices().get<by_id>();
-       auto event_itr = event_index.cbegin();
-       while (event_itr != event_index.cend())
-       {
-           const event_object& event_obj = *event_itr;
-           ++event_itr;
-           for(const std::pair<std::string, std::string>& pair : event_obj.name)
-           {
-                localized_event_strings[pair.first].insert(event_string(event_obj.id, pair.second));
-           }
-       }
+       for (const event_object& event_obj : event_index)
+           _event_helper->index_event_names(event_obj);
 }
 
 std::vector<event_object> bookie_plugin_impl::get_events_containing_sub_string(const std::string& sub_string, const std::string& language)
 {
    graphene::chain::database& db = database();
    std::vector<event_object> events;
-   if (localized_event_strings.find(language) != localized_event_strings.end())
+   const auto& localized_event_names = _event_helper->localized_event_names();
+   auto language_iter = localized_event_names.find(language);
+   if (language_iter != localized_event_names.end())
    {
-      std::string lower_case_sub_string = boost::algorithm::to_lower_copy(sub_string);
-      const event_string_set& language_set = localized_event_strings[language];
-      for (const event_string& pair : language_set)
+      for (event_id_type event_id : language_iter->second.find(boost::algorithm::to_lower_copy(sub_string)))
       {
-         std::string lower_case_string = boost::algorithm::to_lower_copy(pair.second);
-         if (lower_case_string.find(lower_case_sub_string) != std::string::npos)
-            events.push_back(pair.first(db));
+         const event_object* event_obj = db.find(event_id);
+         if (event_obj)
+            events.push_back(*event_obj);
       }
    }
    return events;
@@ -469,9 +559,9 @@ void bookie_plugin::plugin_initialize(const boost::program_options::variables_ma
     ilog("bookie plugin: plugin_startup() begin");
     database().force_slow_replays();
     database().applied_block.connect( [&]( const signed_block& b){ my->on_block_applied(b); } );
-    database().changed_objects.connect([&](const vector<object_id_type>& changed_object_ids, const fc::flat_set<graphene::chain::account_id_type>& impacted_accounts){ my->on_objects_changed(changed_object_ids); });
-    database().new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) { my->on_objects_new(ids); });
-    database().removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) { my->on_objects_removed(ids); });
+    database().changed_objects.connect([&](const vector<object_id_type>& changed_object_ids, const graphene::chain::lazy_account_set& impacted_accounts){ my->on_objects_changed(changed_object_ids); });
+    database().new_objects.connect([this](const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts) { my->on_objects_new(ids); });
+    database().removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const lazy_account_set& impacted_accounts) { my->on_objects_removed(ids); });
 
 
     //auto event_index =
@@ -498,6 +588,7 @@ void bookie_plugin::plugin_initialize(const boost::program_options::variables_ma
     primary_index<event_object_index>& nonconst_event_object_idx = const_cast<primary_index<event_object_index>&>(event_object_idx);
     detail::persistent_event_object_helper* persistent_event_object_helper_index = nonconst_event_object_idx.add_secondary_index<detail::persistent_event_object_helper>();
     persistent_event_object_helper_index->set_plugin_instance(this);
+    my->_event_helper = persistent_event_object_helper_index;
 
     ilog("bookie plugin: plugin_startup() end");
  }
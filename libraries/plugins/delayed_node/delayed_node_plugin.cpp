@@ -32,6 +32,7 @@
 #include <fc/api.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <deque>
 
 namespace graphene { namespace delayed_node {
 namespace bpo = boost::program_options;
@@ -45,6 +46,10 @@ struct delayed_node_plugin_impl {
    boost::signals2::scoped_connection client_connection_closed;
    graphene::chain::block_id_type last_received_remote_head;
    graphene::chain::block_id_type last_processed_remote_head;
+   /// number of get_block calls kept in flight while catching up
+   uint32_t fetch_window = 16;
+   /// skip flags for blocks the trusted node already considers irreversible
+   uint32_t push_skip_flags = graphene::chain::database::skip_nothing;
 };
 }
 
@@ -59,6 +64,10 @@ void delayed_node_plugin::plugin_set_program_options(bpo::options_description& c
 {
    cli.add_options()
          ("trusted-node", boost::program_options::value<std::string>(), "RPC endpoint of a trusted validating node (required)")
+         ("trusted-node-fetch-window", boost::program_options::value<uint32_t>()->default_value(16),
+          "Number of blocks requested from the trusted node ahead of the one being applied")
+         ("trusted-node-skip-validation", boost::program_options::value<bool>()->default_value(false),
+          "Apply blocks that are irreversible on the trusted node with the checks skipped during a replay")
          ;
    cfg.add(cli);
 }
@@ -76,6 +85,18 @@ void delayed_node_plugin::plugin_initialize(const boost::program_options::variab
 {
    FC_ASSERT(options.count("trusted-node") > 0);
    my->remote_endpoint = "ws://" + options.at("trusted-node").as<std::string>();
+   if( options.count("trusted-node-fetch-window") )
+      my->fetch_window = std::max<uint32_t>( 1, options.at("trusted-node-fetch-window").as<uint32_t>() );
+   if( options.count("trusted-node-skip-validation") && options.at("trusted-node-skip-validation").as<bool>() )
+   {
+      using graphene::chain::database;
+      my->push_skip_flags = database::skip_witness_signature |
+                            database::skip_transaction_signatures |
+                            database::skip_transaction_dupe_check |
+                            database::skip_tapos_check |
+                            database::skip_witness_schedule_check |
+                            database::skip_authority_check;
+   }
 }
 
 void delayed_node_plugin::sync_with_trusted_node()
@@ -99,12 +120,23 @@ void delayed_node_plugin::sync_with_trusted_node()
          break;
       }
       pass_count++;
+      // keep up to fetch_window requests outstanding so that fetching overlaps with applying
+      std::deque<fc::future<fc::optional<graphene::chain::signed_block>>> pending;
+      uint32_t next_to_fetch = db.head_block_num() + 1;
       while( remote_dpo.last_irreversible_block_num > db.head_block_num() )
       {
-         fc::optional<graphene::chain::signed_block> block = my->database_api->get_block( db.head_block_num()+1 );
+         while( pending.size() < my->fetch_window && next_to_fetch <= remote_dpo.last_irreversible_block_num )
+         {
+            const uint32_t block_num = next_to_fetch++;
+            pending.push_back( fc::async( [this, block_num]() {
+               return my->database_api->get_block( block_num );
+            }, "delayed_node fetch block" ) );
+         }
+         fc::optional<graphene::chain::signed_block> block = pending.front().wait();
+         pending.pop_front();
          FC_ASSERT(block, "Trusted node claims it has blocks it doesn't actually have.");
          ilog("Pushing block #${n}", ("n", block->block_num()));
-         db.push_block(*block);
+         db.push_block(*block, my->push_skip_flags);
          synced_blocks++;
       }
    }
@@ -26,8 +26,13 @@
 #include <graphene/chain/impacted.hpp>
 #include <graphene/chain/account_evaluator.hpp>
 #include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
 #include <curl/curl.h>
 
+#include <list>
+#include <map>
+#include <tuple>
+
 namespace graphene { namespace elasticsearch {
 
 namespace detail
@@ -43,6 +48,14 @@ class elasticsearch_plugin_impl
 
       bool update_account_histories( const signed_block& b );
 
+      /// posts a search to the query worker with the fewest queries in flight, an empty response if ES is down
+      std::string query_elasticsearch( const std::string& query, bool check_es );
+
+      typedef std::tuple< account_id_type, operation_history_id_type, unsigned, operation_history_id_type > history_query_key;
+      optional< vector<operation_history_object> > find_cached_history( const history_query_key& key );
+      void cache_history( const history_query_key& key, const vector<operation_history_object>& result );
+      void invalidate_cached_history( const account_id_type account_id );
+
       graphene::chain::database& database()
       {
          return _self.database();
@@ -61,11 +74,17 @@ class elasticsearch_plugin_impl
       uint32_t _elasticsearch_start_es_after_block = 0;
       bool _elasticsearch_operation_string = true;
       mode _elasticsearch_mode = mode::only_save;
+      uint32_t _elasticsearch_max_in_flight = 4;
+      uint32_t _elasticsearch_max_queued_bulks = 16;
+      std::string _elasticsearch_spill_dir = "";
+      uint16_t _elasticsearch_query_threads = 4;
+      uint32_t _elasticsearch_query_cache_size = 256;
       CURL *curl; // curl handler
       vector <string> bulk_lines; //  vector of op lines
       vector<std::string> prepare;
 
-      graphene::utilities::ES es;
+      // posts the bulks so block application does not wait for elasticsearch
+      std::unique_ptr<graphene::utilities::ESBulkSender> sender;
       uint32_t limit_documents;
       int16_t op_type;
       operation_history_struct os;
@@ -76,6 +95,27 @@ class elasticsearch_plugin_impl
       std::string index_name;
       bool is_sync = false;
       fc::time_point last_sync;
+
+      /// serves history queries on its own thread with its own curl handle
+      struct query_worker
+      {
+         explicit query_worker( const std::string& name ) : thread( name ), curl( curl_easy_init() ) {}
+         ~query_worker()
+         {
+            thread.quit();
+            curl_easy_cleanup( curl );
+         }
+
+         fc::thread thread;
+         CURL*      curl;
+         uint32_t   in_flight = 0; ///< only used by the thread posting the queries
+      };
+      vector< std::unique_ptr<query_worker> > query_workers;
+
+      // least recently used account history results, newest first
+      typedef std::list< history_query_key > history_cache_order;
+      history_cache_order _history_cache_order;
+      std::map< history_query_key, std::pair< vector<operation_history_object>, history_cache_order::iterator > > _history_cache;
    private:
       bool add_elasticsearch( const account_id_type account_id, const optional<operation_history_object>& oho, const uint32_t block_number );
       const account_transaction_history_object& addNewEntry(const account_statistics_object& stats_obj,
@@ -91,11 +131,12 @@ class elasticsearch_plugin_impl
       void cleanObjects(const account_transaction_history_object& ath, account_id_type account_id);
       void createBulkLine(const account_transaction_history_object& ath);
       void prepareBulk(const account_transaction_history_id_type& ath_id);
-      void populateESstruct();
+      void sendBulk();
 };
 
 elasticsearch_plugin_impl::~elasticsearch_plugin_impl()
 {
+   sender.reset();
    if (curl) {
       curl_easy_cleanup(curl);
       curl = nullptr;
@@ -120,7 +161,8 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
       else
          _oho_index->use_next_id();
    };
-   for( const optional< operation_history_object >& o_op : hist ) {
+   for( size_t op_index = 0; op_index < hist.size(); ++op_index ) {
+      const optional< operation_history_object >& o_op = hist[op_index];
       optional <operation_history_object> oho;
 
       auto create_oho = [&]() {
@@ -152,21 +194,8 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
       if(_elasticsearch_visitor)
          doVisitor(oho);
 
-      const operation_history_object& op = *o_op;
-
       // get the set of accounts this operation applies to
-      flat_set<account_id_type> impacted;
-      vector<authority> other;
-      operation_get_required_authorities( op.op, impacted, impacted, other ); // fee_payer is added here
-
-      if( op.op.which() == operation::tag< account_create_operation >::value )
-         impacted.insert( op.result.get<object_id_type>() );
-      else
-         graphene::chain::operation_get_impacted_accounts( op.op, impacted );
-
-      for( auto& a : other )
-         for( auto& item : a.account_auths )
-            impacted.insert( item.first );
+      const flat_set<account_id_type>& impacted = db.get_applied_operation_impacted_accounts( op_index );
 
       for( auto& account_id : impacted )
       {
@@ -175,18 +204,8 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
       }
    }
    // we send bulk at end of block when we are in sync for better real time client experience
-   if(is_sync)
-   {
-      populateESstruct();
-      if(es.bulk_lines.size() > 0)
-      {
-         prepare.clear();
-         if(!graphene::utilities::SendBulk(es))
-            return false;
-         else
-            bulk_lines.clear();
-      }
-   }
+   if(is_sync && bulk_lines.size() > 0)
+      sendBulk();
 
    return true;
 }
@@ -272,21 +291,86 @@ bool elasticsearch_plugin_impl::add_elasticsearch( const account_id_type account
    if(block_number > _elasticsearch_start_es_after_block)  {
       createBulkLine(ath);
       prepareBulk(ath.id);
+      invalidate_cached_history(account_id);
    }
    cleanObjects(ath, account_id);
 
-   if (curl && bulk_lines.size() >= limit_documents) { // we are in bulk time, ready to add data to elasticsearech
-      prepare.clear();
-      populateESstruct();
-      if(!graphene::utilities::SendBulk(es))
-         return false;
-      else
-         bulk_lines.clear();
-   }
+   if (sender && bulk_lines.size() >= limit_documents) // we are in bulk time, ready to add data to elasticsearech
+      sendBulk();
 
    return true;
 }
 
+std::string elasticsearch_plugin_impl::query_elasticsearch( const std::string& query, bool check_es )
+{
+   FC_ASSERT( !query_workers.empty(), "Elasticsearch queries are not served in mode only_save" );
+
+   query_worker* worker = query_workers.front().get();
+   for( const auto& w : query_workers )
+      if( w->in_flight < worker->in_flight )
+         worker = w.get();
+
+   graphene::utilities::ES es;
+   es.curl = worker->curl;
+   es.elasticsearch_url = _elasticsearch_node_url;
+   es.auth = _elasticsearch_basic_auth;
+   es.index_prefix = _elasticsearch_index_prefix;
+   es.endpoint = es.index_prefix + "*/data/_search";
+   es.query = query;
+
+   ++worker->in_flight;
+   std::string response;
+   try
+   {
+      // waiting only blocks the calling fiber, the API thread serves other requests meanwhile
+      response = worker->thread.async( [es,check_es]() mutable -> std::string {
+         if( check_es && !graphene::utilities::checkES( es ) )
+            return std::string();
+         return graphene::utilities::simpleQuery( es );
+      }, "elasticsearch query" ).wait();
+   }
+   catch( ... )
+   {
+      --worker->in_flight;
+      throw;
+   }
+   --worker->in_flight;
+   return response;
+}
+
+optional< vector<operation_history_object> > elasticsearch_plugin_impl::find_cached_history( const history_query_key& key )
+{
+   auto itr = _history_cache.find( key );
+   if( itr == _history_cache.end() )
+      return optional< vector<operation_history_object> >();
+   _history_cache_order.splice( _history_cache_order.begin(), _history_cache_order, itr->second.second );
+   return itr->second.first;
+}
+
+void elasticsearch_plugin_impl::cache_history( const history_query_key& key, const vector<operation_history_object>& result )
+{
+   if( _elasticsearch_query_cache_size == 0 || _history_cache.find( key ) != _history_cache.end() )
+      return;
+   while( _history_cache.size() >= _elasticsearch_query_cache_size )
+   {
+      _history_cache.erase( _history_cache_order.back() );
+      _history_cache_order.pop_back();
+   }
+   _history_cache_order.push_front( key );
+   _history_cache.emplace( key, std::make_pair( result, _history_cache_order.begin() ) );
+}
+
+void elasticsearch_plugin_impl::invalidate_cached_history( const account_id_type account_id )
+{
+   auto itr = _history_cache.lower_bound( history_query_key( account_id, operation_history_id_type(), 0,
+                                                             operation_history_id_type() ) );
+   while( itr != _history_cache.end() && std::get<0>( itr->first ) == account_id )
+   {
+      _history_cache_order.erase( itr->second.second );
+      itr = _history_cache.erase( itr );
+   }
+}
+
 const account_statistics_object& elasticsearch_plugin_impl::getStatsObject(const account_id_type account_id)
 {
    graphene::chain::database& db = database();
@@ -371,12 +455,11 @@ void elasticsearch_plugin_impl::cleanObjects(const account_transaction_history_o
    }
 }
 
-void elasticsearch_plugin_impl::populateESstruct()
+void elasticsearch_plugin_impl::sendBulk()
 {
-   es.curl = curl;
-   es.bulk_lines = bulk_lines;
-   es.elasticsearch_url = _elasticsearch_node_url;
-   es.auth = _elasticsearch_basic_auth;
+   prepare.clear();
+   sender->enqueue(std::move(bulk_lines));
+   bulk_lines.clear();
 }
 
 } // end namespace detail
@@ -425,6 +508,17 @@ void elasticsearch_plugin::plugin_set_program_options(
                "Save operation as string. Needed to serve history api calls(true)")
          ("elasticsearch-mode", boost::program_options::value<uint16_t>(),
                "Mode of operation: only_save(0), only_query(1), all(2) - Default: 0")
+         ("elasticsearch-max-in-flight", boost::program_options::value<uint32_t>(),
+               "Number of bulk requests sent to elasticsearch concurrently(4)")
+         ("elasticsearch-max-queued-bulks", boost::program_options::value<uint32_t>(),
+               "Number of bulks waiting to be sent before block processing waits for elasticsearch(16)")
+         ("elasticsearch-spill-dir", boost::program_options::value<std::string>(),
+               "Directory keeping bulks elasticsearch does not accept in time, to be sent later"
+               "(elasticsearch-spill in the data directory)")
+         ("elasticsearch-query-threads", boost::program_options::value<uint16_t>(),
+               "Number of threads serving history queries, each with its own connection(4)")
+         ("elasticsearch-query-cache-size", boost::program_options::value<uint32_t>(),
+               "Number of account history query results kept in memory, 0 to disable(256)")
          ;
    cfg.add(cli);
 }
@@ -467,12 +561,34 @@ void elasticsearch_plugin::plugin_initialize(const boost::program_options::varia
          FC_THROW_EXCEPTION(fc::exception, "Elasticsearch mode not valid");
       my->_elasticsearch_mode = static_cast<mode>(options["elasticsearch-mode"].as<uint16_t>());
    }
+   if (options.count("elasticsearch-max-in-flight")) {
+      my->_elasticsearch_max_in_flight = options["elasticsearch-max-in-flight"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-max-queued-bulks")) {
+      my->_elasticsearch_max_queued_bulks = options["elasticsearch-max-queued-bulks"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-spill-dir")) {
+      my->_elasticsearch_spill_dir = options["elasticsearch-spill-dir"].as<std::string>();
+   }
+   if (options.count("elasticsearch-query-threads")) {
+      my->_elasticsearch_query_threads = std::max<uint16_t>(options["elasticsearch-query-threads"].as<uint16_t>(), 1);
+   }
+   if (options.count("elasticsearch-query-cache-size")) {
+      my->_elasticsearch_query_cache_size = options["elasticsearch-query-cache-size"].as<uint32_t>();
+   }
 
    if(my->_elasticsearch_mode != mode::only_query) {
       if (my->_elasticsearch_mode == mode::all && !my->_elasticsearch_operation_string)
          FC_THROW_EXCEPTION(fc::exception,
                "If elasticsearch-mode is set to all then elasticsearch-operation-string need to be true");
 
+      if (my->_elasticsearch_spill_dir.empty())
+         my->_elasticsearch_spill_dir = (app().data_dir() / "elasticsearch-spill").generic_string();
+      my->sender.reset(new graphene::utilities::ESBulkSender(my->_elasticsearch_node_url, my->_elasticsearch_basic_auth,
+                                                             my->_elasticsearch_max_in_flight,
+                                                             my->_elasticsearch_max_queued_bulks,
+                                                             my->_elasticsearch_spill_dir));
+
       database().applied_block.connect([this](const signed_block &b) {
          if (!my->update_account_histories(b))
             FC_THROW_EXCEPTION(fc::exception,
@@ -490,6 +606,12 @@ void elasticsearch_plugin::plugin_startup()
 
    if(!graphene::utilities::checkES(es))
       FC_THROW_EXCEPTION(fc::exception, "ES database is not up in url ${url}", ("url", my->_elasticsearch_node_url));
+
+   if(my->_elasticsearch_mode != mode::only_save) {
+      for(uint16_t i = 0; i < my->_elasticsearch_query_threads; ++i)
+         my->query_workers.emplace_back(new detail::elasticsearch_plugin_impl::query_worker(
+               "elasticsearch query " + std::to_string(i)));
+   }
    ilog("elasticsearch ACCOUNT HISTORY: plugin_startup() begin");
 }
 
@@ -508,8 +630,7 @@ operation_history_object elasticsearch_plugin::get_operation_by_id(operation_his
    }
    )";
 
-   auto es = prepareHistoryQuery(query);
-   const auto response = graphene::utilities::simpleQuery(es);
+   const auto response = my->query_elasticsearch(query, false);
    variant variant_response = fc::json::from_string(response);
    const auto source = variant_response["hits"]["hits"][size_t(0)]["_source"];
    return fromEStoOperation(source);
@@ -521,6 +642,11 @@ vector<operation_history_object> elasticsearch_plugin::get_account_history(
       unsigned limit = 100,
       operation_history_id_type start = operation_history_id_type())
 {
+   const auto key = detail::elasticsearch_plugin_impl::history_query_key(account_id, stop, limit, start);
+   auto cached = my->find_cached_history(key);
+   if(cached.valid())
+      return *cached;
+
    const string account_id_string = std::string(object_id_type(account_id));
 
    const auto stop_number = stop.instance.value;
@@ -550,14 +676,12 @@ vector<operation_history_object> elasticsearch_plugin::get_account_history(
    }
    )";
 
-   auto es = prepareHistoryQuery(query);
-
    vector<operation_history_object> result;
 
-   if(!graphene::utilities::checkES(es))
+   const auto response = my->query_elasticsearch(query, true);
+   if(response.empty())
       return result;
 
-   const auto response = graphene::utilities::simpleQuery(es);
    variant variant_response = fc::json::from_string(response);
    
    const auto hits = variant_response["hits"]["total"]["value"];
@@ -574,6 +698,11 @@ vector<operation_history_object> elasticsearch_plugin::get_account_history(
       const auto source = variant_response["hits"]["hits"][size_t(i)]["_source"];
       result.push_back(fromEStoOperation(source));
    }
+
+   // only cache once ES has indexed the start operation, so a result missing operations still being indexed
+   // is not kept. Newer operations of the account invalidate the cached results when they are indexed.
+   if(!result.empty() && result.front().id == object_id_type(start))
+      my->cache_history(key, result);
    return result;
 }
 
@@ -598,21 +727,6 @@ operation_history_object elasticsearch_plugin::fromEStoOperation(variant source)
    return result;
 }
 
-graphene::utilities::ES elasticsearch_plugin::prepareHistoryQuery(string query)
-{
-   CURL *curl;
-   curl = curl_easy_init();
-
-   graphene::utilities::ES es;
-   es.curl = curl;
-   es.elasticsearch_url = my->_elasticsearch_node_url;
-   es.index_prefix = my->_elasticsearch_index_prefix;
-   es.endpoint = es.index_prefix + "*/data/_search";
-   es.query = query;
-
-   return es;
-}
-
 mode elasticsearch_plugin::get_running_mode()
 {
    return my->_elasticsearch_mode;
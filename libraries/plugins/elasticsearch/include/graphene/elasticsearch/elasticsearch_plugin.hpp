@@ -76,7 +76,6 @@ class elasticsearch_plugin : public graphene::app::plugin
 
    private:
       operation_history_object fromEStoOperation(variant source);
-      graphene::utilities::ES prepareHistoryQuery(string query);
 };
 
 
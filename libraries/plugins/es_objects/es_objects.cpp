@@ -324,19 +324,19 @@ void es_objects_plugin::plugin_initialize(const boost::program_options::variable
       }
    });
 
-   database().new_objects.connect([this]( const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts ) {
+   database().new_objects.connect([this]( const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts ) {
       if(!my->index_database(ids, "create"))
       {
          FC_THROW_EXCEPTION(fc::exception, "Error creating object from ES database, we are going to keep trying.");
       }
    });
-   database().changed_objects.connect([this]( const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts ) {
+   database().changed_objects.connect([this]( const vector<object_id_type>& ids, const lazy_account_set& impacted_accounts ) {
       if(!my->index_database(ids, "update"))
       {
          FC_THROW_EXCEPTION(fc::exception, "Error updating object from ES database, we are going to keep trying.");
       }
    });
-   database().removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) {
+   database().removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const lazy_account_set& impacted_accounts) {
        if(!my->index_database(ids, "delete"))
        {
           FC_THROW_EXCEPTION(fc::exception, "Error deleting object from ES database, we are going to keep trying.");
@@ -25,9 +25,12 @@
 
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/market_object.hpp>
 
 #include <fc/thread/future.hpp>
 
+#include <boost/multi_index/composite_key.hpp>
+
 namespace graphene { namespace market_history {
 using namespace chain;
 
@@ -106,7 +109,50 @@ struct order_history_object : public abstract_object<order_history_object>
   fill_order_operation op;
 };
 
+/**
+ *  Trades of one market that happened within the same market_ticker_object::bucket_seconds interval.
+ *  Amounts are denominated the same way as in the owning market_ticker_object.
+ */
+struct market_ticker_bucket
+{
+   fc::time_point_sec  open;
+   share_type          base_volume;
+   share_type          quote_volume;
+   share_type          close_base;
+   share_type          close_quote;
+};
+
+/**
+ *  Rolling 24h statistics of a market, kept up to date as fill_order_operations are applied so that
+ *  tickers can be served without walking the order history.  Volumes are aggregated in buckets of
+ *  bucket_seconds which are dropped once they have left the window entirely, so the window is accurate
+ *  to bucket_seconds.  base is always the asset with the lower id.
+ */
+struct market_ticker_object : public abstract_object<market_ticker_object>
+{
+   static const uint8_t space_id = ACCOUNT_HISTORY_SPACE_ID;
+   static const uint8_t type_id  = 3;
+
+   static const uint32_t window_seconds = 86400;
+   static const uint32_t bucket_seconds = 300;
+
+   asset_id_type                  base;
+   asset_id_type                  quote;
+   /** amounts of the most recent trade */
+   share_type                     latest_base;
+   share_type                     latest_quote;
+   /** amounts of the most recent trade that has left the window, zero if none has */
+   share_type                     last_day_base;
+   share_type                     last_day_quote;
+   share_type                     base_volume;
+   share_type                     quote_volume;
+   vector<market_ticker_bucket>   buckets;
+   /** when the oldest bucket leaves the window */
+   fc::time_point_sec             next_expiration = fc::time_point_sec::maximum();
+};
+
 struct by_key;
+struct by_market;
 typedef multi_index_container<
    bucket_object,
    indexed_by<
@@ -124,8 +170,25 @@ typedef multi_index_container<
 > order_history_multi_index_type;
 
 
+typedef multi_index_container<
+   market_ticker_object,
+   indexed_by<
+      hashed_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag<by_market>,
+         composite_key< market_ticker_object,
+            member< market_ticker_object, asset_id_type, &market_ticker_object::base >,
+            member< market_ticker_object, asset_id_type, &market_ticker_object::quote >
+         >
+      >,
+      ordered_non_unique< tag<by_expiration>,
+         member< market_ticker_object, fc::time_point_sec, &market_ticker_object::next_expiration >
+      >
+   >
+> market_ticker_multi_index_type;
+
 typedef generic_index<bucket_object, bucket_object_multi_index_type> bucket_index;
 typedef generic_index<order_history_object, order_history_multi_index_type> history_index;
+typedef generic_index<market_ticker_object, market_ticker_multi_index_type> market_ticker_index;
 
 
 namespace detail
@@ -172,4 +235,11 @@ FC_REFLECT_DERIVED( graphene::market_history::bucket_object, (graphene::db::obje
                     (open_base)(open_quote)
                     (close_base)(close_quote)
                     (base_volume)(quote_volume) )
-
+FC_REFLECT( graphene::market_history::market_ticker_bucket,
+            (open)(base_volume)(quote_volume)(close_base)(close_quote) )
+FC_REFLECT_DERIVED( graphene::market_history::market_ticker_object, (graphene::db::object),
+                    (base)(quote)
+                    (latest_base)(latest_quote)
+                    (last_day_base)(last_day_quote)
+                    (base_volume)(quote_volume)
+                    (buckets)(next_expiration) )
@@ -53,6 +53,9 @@ class market_history_plugin_impl
        */
       void update_market_histories( const signed_block& b );
 
+      /** fills the ticker index from the order history if it was not part of the loaded state */
+      void rebuild_tickers();
+
       graphene::chain::database& database()
       {
          return _self.database();
@@ -64,6 +67,73 @@ class market_history_plugin_impl
 };
 
 
+/** drops the buckets of a ticker that have left the 24h window ending at now */
+static void expire_ticker_buckets( market_ticker_object& t, fc::time_point_sec now )
+{
+   const uint32_t lifetime = market_ticker_object::bucket_seconds + market_ticker_object::window_seconds;
+   auto itr = t.buckets.begin();
+   while( itr != t.buckets.end() && itr->open + lifetime <= now )
+   {
+      t.base_volume -= itr->base_volume;
+      t.quote_volume -= itr->quote_volume;
+      t.last_day_base = itr->close_base;
+      t.last_day_quote = itr->close_quote;
+      ++itr;
+   }
+   t.buckets.erase( t.buckets.begin(), itr );
+   t.next_expiration = t.buckets.empty() ? fc::time_point_sec::maximum() : t.buckets.front().open + lifetime;
+}
+
+/** adds a fill to the ticker of its market, o.pays must be the asset with the lower id */
+static void apply_fill_to_ticker( database& db, const fill_order_operation& o, fc::time_point_sec time )
+{
+   const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
+   auto update_ticker = [&]( market_ticker_object& t ) {
+      expire_ticker_buckets( t, time );
+
+      t.latest_base = o.pays.amount;
+      t.latest_quote = o.receives.amount;
+      t.base_volume += o.pays.amount;
+      t.quote_volume += o.receives.amount;
+
+      const fc::time_point_sec open( (time.sec_since_epoch() / market_ticker_object::bucket_seconds)
+                                     * market_ticker_object::bucket_seconds );
+      if( t.buckets.empty() || t.buckets.back().open != open )
+      {
+         t.buckets.emplace_back();
+         t.buckets.back().open = open;
+      }
+      market_ticker_bucket& bucket = t.buckets.back();
+      bucket.base_volume += o.pays.amount;
+      bucket.quote_volume += o.receives.amount;
+      bucket.close_base = o.pays.amount;
+      bucket.close_quote = o.receives.amount;
+
+      t.next_expiration = t.buckets.front().open
+                          + ( market_ticker_object::bucket_seconds + market_ticker_object::window_seconds );
+   };
+
+   auto itr = ticker_idx.find( boost::make_tuple( o.pays.asset_id, o.receives.asset_id ) );
+   if( itr == ticker_idx.end() )
+      db.create<market_ticker_object>( [&]( market_ticker_object& t ) {
+         t.base = o.pays.asset_id;
+         t.quote = o.receives.asset_id;
+         update_ticker( t );
+      });
+   else
+      db.modify( *itr, update_ticker );
+}
+
+/** drops the expired buckets of tickers that have not seen a trade recently */
+static void expire_tickers( database& db, fc::time_point_sec now )
+{
+   const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_expiration>();
+   while( !ticker_idx.empty() && ticker_idx.begin()->next_expiration <= now )
+      db.modify( *ticker_idx.begin(), [&]( market_ticker_object& t ) {
+         expire_ticker_buckets( t, now );
+      });
+}
+
 struct operation_process_fill_order
 {
    market_history_plugin&    _plugin;
@@ -123,6 +193,10 @@ struct operation_process_fill_order
       */
 
 
+      // one fill order operation is created for each side of a match, count the match once
+      if( o.pays.asset_id < o.receives.asset_id )
+         apply_fill_to_ticker( db, o, _now );
+
       auto max_history = _plugin.max_history();
       for( auto bucket : buckets )
       {
@@ -220,6 +294,8 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
    if( _tracked_buckets.size() == 0 ) return;
 
    graphene::chain::database& db = database();
+   expire_tickers( db, b.timestamp );
+
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
    for( const optional< operation_history_object >& o_op : hist )
    {
@@ -228,6 +304,29 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
    }
 }
 
+void market_history_plugin_impl::rebuild_tickers()
+{
+   graphene::chain::database& db = database();
+   if( !db.get_index_type<market_ticker_index>().indices().empty() )
+      return;
+
+   // within a market newer fills have lower sequence numbers, so walk backwards to see them in order
+   const auto& history_idx = db.get_index_type<history_index>().indices().get<by_key>();
+   uint64_t fills = 0;
+   for( auto itr = history_idx.rbegin(); itr != history_idx.rend(); ++itr )
+   {
+      if( itr->op.pays.asset_id < itr->op.receives.asset_id )
+      {
+         apply_fill_to_ticker( db, itr->op, itr->time );
+         ++fills;
+      }
+   }
+   expire_tickers( db, db.head_block_time() );
+
+   if( fills > 0 )
+      ilog( "Rebuilt market tickers from ${n} fills", ("n",fills) );
+}
+
 } // end namespace detail
 
 
@@ -268,6 +367,7 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
    database().applied_block.connect( [this]( const signed_block& b){ my->update_market_histories(b); } );
    database().add_index< primary_index< bucket_index  > >();
    database().add_index< primary_index< history_index  > >();
+   database().add_index< primary_index< market_ticker_index  > >();
 
    if( options.count( "bucket-size" ) )
    {
@@ -281,6 +381,7 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
 
 void market_history_plugin::plugin_startup()
 {
+   my->rebuild_tickers();
 }
 
 const flat_set<uint32_t>& market_history_plugin::tracked_buckets() const
@@ -25,11 +25,50 @@
 
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
+#include <graphene/db/thread_pool.hpp>
 
 #include <fc/time.hpp>
 
 namespace graphene { namespace snapshot_plugin {
 
+/**
+ * Binary snapshots start with snapshot_magic and a format version, followed by a zlib stream holding
+ * a snapshot_header, the signed head block and, for each index, a snapshot_section_header, the packed
+ * objects of the index as vector<char> records and the sha256 of those records.
+ */
+static const uint64_t snapshot_magic          = 0x504e534e48505247ULL; // "GRPHNSNP"
+static const uint32_t snapshot_format_version = 2;
+
+struct snapshot_header
+{
+   graphene::chain::chain_id_type chain_id;
+   uint32_t                       head_block_num = 0;
+   graphene::chain::block_id_type head_block_id;
+   fc::time_point_sec             head_block_time;
+   uint32_t                       section_count = 0;
+};
+
+struct snapshot_section_header
+{
+   uint8_t                      space_id = 0;
+   uint8_t                      type_id = 0;
+   graphene::db::object_id_type next_id;
+   uint64_t                     object_count = 0;
+};
+
+/**
+ * Writes a binary snapshot of the current state of @p db, whose head block is @p head_block, to @p dest
+ */
+void save_binary_snapshot( const graphene::chain::database& db, const graphene::chain::signed_block& head_block,
+                           const fc::path& dest );
+
+/**
+ * Turns a binary snapshot into the object database of a new node in @p chain_dir, which is opened
+ * from there by database::open() like after a regular shutdown.  The head block goes into the block
+ * log, so the node can link the blocks following it.  Throws if the snapshot is corrupt.
+ */
+snapshot_header load_binary_snapshot( const fc::path& snapshot, const fc::path& chain_dir );
+
 class snapshot_plugin : public graphene::app::plugin {
    public:
       ~snapshot_plugin() {}
@@ -48,10 +87,21 @@ class snapshot_plugin : public graphene::app::plugin {
 
    private:
        void check_snapshot( const graphene::chain::signed_block& b);
+       void create_binary_snapshot( const graphene::chain::signed_block& head_block );
 
        uint32_t           snapshot_block = -1, last_block = 0;
        fc::time_point_sec snapshot_time = fc::time_point_sec::maximum(), last_time = fc::time_point_sec(1);
        fc::path           dest;
+       bool               binary = false;
+
+       /// writes binary snapshots so block application only waits for the objects to be copied
+       std::unique_ptr<graphene::db::thread_pool> writer;
+       fc::future<void>                           pending_write;
 };
 
 } } //graphene::snapshot_plugin
+
+FC_REFLECT( graphene::snapshot_plugin::snapshot_header,
+            (chain_id)(head_block_num)(head_block_id)(head_block_time)(section_count) )
+FC_REFLECT( graphene::snapshot_plugin::snapshot_section_header,
+            (space_id)(type_id)(next_id)(object_count) )
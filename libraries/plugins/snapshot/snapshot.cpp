@@ -23,9 +23,16 @@
  */
 #include <graphene/snapshot/snapshot.hpp>
 
+#include <graphene/chain/block_database.hpp>
 #include <graphene/chain/database.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <fstream>
 
 using namespace graphene::snapshot_plugin;
 using std::string;
@@ -36,6 +43,8 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_LOAD       = "snapshot-load-from";
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
@@ -45,6 +54,10 @@ void snapshot_plugin::plugin_set_program_options(
          (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
          (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("json"),
+          "Snapshot format, 'json' for one JSON object per line or 'binary' for a compressed binary snapshot "
+          "written in the background, which can be loaded with snapshot-load-from")
+         (OPT_LOAD, bpo::value<string>(), "Pathname of a binary snapshot to bootstrap a node without chain state from")
          ;
    config_file_options.add(command_line_options);
 }
@@ -63,6 +76,17 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_LOAD) )
+   {
+      FC_ASSERT( !options.count("resync-blockchain") && !options.count("replay-blockchain"),
+                 "Cannot combine snapshot-load-from with resync-blockchain or replay-blockchain!" );
+      const fc::path chain_dir = app().data_dir() / "blockchain";
+      if( fc::exists( chain_dir / "object_database" ) )
+         ilog( "snapshot plugin: chain state exists already, ignoring ${f}", ("f",options[OPT_LOAD].as<std::string>()) );
+      else
+         load_binary_snapshot( options[OPT_LOAD].as<std::string>(), chain_dir );
+   }
+
    if( options.count(OPT_BLOCK_NUM) || options.count(OPT_BLOCK_TIME) )
    {
       FC_ASSERT( options.count(OPT_DEST), "Must specify snapshot-to in addition to snapshot-at-block or snapshot-at-time!" );
@@ -71,6 +95,11 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) )
          snapshot_time = fc::time_point_sec::from_iso_string( options[OPT_BLOCK_TIME].as<std::string>() );
+      const std::string format = options[OPT_FORMAT].as<std::string>();
+      FC_ASSERT( format == "json" || format == "binary", "Unknown snapshot-format ${f}", ("f",format) );
+      binary = ( format == "binary" );
+      if( binary )
+         writer.reset( new graphene::db::thread_pool( 1, "snapshot" ) );
       database().applied_block.connect( [&]( const graphene::chain::signed_block& b ) {
          check_snapshot( b );
       });
@@ -82,7 +111,14 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 
 void snapshot_plugin::plugin_startup() {}
 
-void snapshot_plugin::plugin_shutdown() {}
+void snapshot_plugin::plugin_shutdown()
+{
+   if( pending_write.valid() )
+   {
+      ilog( "snapshot plugin: waiting for the snapshot to be written" );
+      pending_write.wait();
+   }
+}
 
 static void create_snapshot( const graphene::chain::database& db, const fc::path& dest )
 {
@@ -97,32 +133,215 @@ static void create_snapshot( const graphene::chain::database& db, const fc::path
       wlog( "Failed to open snapshot destination: ${ex}", ("ex",e) );
       return;
    }
-   for( uint32_t space_id = 0; space_id < 256; space_id++ )
-      for( uint32_t type_id = 0; type_id < 256; type_id++ )
-      {
-         try
-         {
-            db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         }
-         catch (fc::assert_exception& e)
-         {
-            continue;
-         }
-         auto& index = db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
-            out << fc::json::to_string( o.to_variant() ) << '\n';
-         });
-      }
+   db.inspect_all_indexes( [&out]( const graphene::db::index& index ) {
+      index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
+         out << fc::json::to_string( o.to_variant() ) << '\n';
+      });
+   });
    out.close();
    ilog("snapshot plugin: created snapshot");
 }
 
+namespace {
+
+/// objects of one index, copied on the block applying thread
+struct captured_section
+{
+   snapshot_section_header                          header;
+   vector< std::unique_ptr<graphene::db::object> > objects;
+};
+
+/// everything that goes into a snapshot, copied on the block applying thread
+struct captured_state
+{
+   snapshot_header               header;
+   graphene::chain::signed_block head_block;
+   vector<captured_section>      sections;
+};
+
+std::shared_ptr<captured_state> capture_state( const graphene::chain::database& db,
+                                               const graphene::chain::signed_block& head_block )
+{
+   FC_ASSERT( head_block.id() == db.head_block_id(), "Snapshot head block is not the head block of the database" );
+   auto state = std::make_shared<captured_state>();
+   state->header.chain_id        = db.get_chain_id();
+   state->header.head_block_num  = db.head_block_num();
+   state->header.head_block_id   = db.head_block_id();
+   state->header.head_block_time = db.head_block_time();
+   state->head_block             = head_block;
+
+   vector<captured_section>& sections = state->sections;
+   db.inspect_all_indexes( [&sections]( const graphene::db::index& index ) {
+      sections.emplace_back();
+      captured_section& section = sections.back();
+      section.header.space_id = index.object_space_id();
+      section.header.type_id  = index.object_type_id();
+      section.header.next_id  = index.get_next_id();
+      index.inspect_all_objects( [&section]( const graphene::db::object& o ) {
+         section.objects.push_back( o.clone() );
+      });
+      section.header.object_count = section.objects.size();
+   });
+   state->header.section_count = sections.size();
+   return state;
+}
+
+void write_binary_snapshot( const fc::path& dest, const captured_state& state )
+{
+   const fc::path tmp = dest.generic_string() + ".tmp";
+   std::ofstream file( tmp.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+   FC_ASSERT( file, "Failed to open snapshot destination ${f}", ("f",tmp) );
+   fc::raw::pack( file, snapshot_magic );
+   fc::raw::pack( file, snapshot_format_version );
+
+   boost::iostreams::filtering_ostream out;
+   out.push( boost::iostreams::zlib_compressor() );
+   out.push( file );
+   fc::raw::pack( out, state.header );
+   fc::raw::pack( out, state.head_block );
+   for( const auto& section : state.sections )
+   {
+      fc::raw::pack( out, section.header );
+      fc::sha256::encoder enc;
+      for( const auto& obj : section.objects )
+      {
+         const auto record = fc::raw::pack( obj->pack() );
+         enc.write( record.data(), record.size() );
+         out.write( record.data(), record.size() );
+      }
+      fc::raw::pack( out, enc.result() );
+   }
+   out.reset();
+   file.close();
+   FC_ASSERT( file, "Failed to write snapshot ${f}", ("f",tmp) );
+   fc::rename( tmp, dest );
+}
+
+} // anonymous namespace
+
+void graphene::snapshot_plugin::save_binary_snapshot( const graphene::chain::database& db,
+                                                      const graphene::chain::signed_block& head_block,
+                                                      const fc::path& dest )
+{
+   write_binary_snapshot( dest, *capture_state( db, head_block ) );
+}
+
+void snapshot_plugin::create_binary_snapshot( const graphene::chain::signed_block& head_block )
+{
+   if( pending_write.valid() && !pending_write.ready() )
+   {
+      wlog( "snapshot plugin: previous snapshot is still being written, skipping" );
+      return;
+   }
+
+   // Copying the objects is all that has to happen between two blocks, packing, compressing and
+   // writing them is left to the writer thread.
+   const fc::time_point start = fc::time_point::now();
+   auto state = capture_state( database(), head_block );
+   ilog( "snapshot plugin: captured state at block ${b} in ${ms} ms",
+         ("b",state->header.head_block_num)("ms",(fc::time_point::now() - start).count() / 1000) );
+
+   const fc::path path = dest;
+   pending_write = writer->async( [path,state]() {
+      try
+      {
+         write_binary_snapshot( path, *state );
+         ilog( "snapshot plugin: created snapshot ${f}", ("f",path) );
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "snapshot plugin: failed to write snapshot: ${e}", ("e",e.to_detail_string()) );
+      }
+      catch( const std::exception& e )
+      {
+         elog( "snapshot plugin: failed to write snapshot: ${e}", ("e",e.what()) );
+      }
+   }, "snapshot write" );
+}
+
+snapshot_header graphene::snapshot_plugin::load_binary_snapshot( const fc::path& snapshot, const fc::path& chain_dir )
+{ try {
+   ilog( "snapshot plugin: loading snapshot ${f}", ("f",snapshot) );
+   std::ifstream file( snapshot.generic_string(), std::ios::in | std::ios::binary );
+   FC_ASSERT( file, "Failed to open snapshot" );
+   uint64_t magic = 0;
+   uint32_t version = 0;
+   fc::raw::unpack( file, magic );
+   fc::raw::unpack( file, version );
+   FC_ASSERT( magic == snapshot_magic, "Not a binary snapshot" );
+   FC_ASSERT( version == snapshot_format_version, "Unsupported snapshot format version ${v}", ("v",version) );
+
+   boost::iostreams::filtering_istream in;
+   in.push( boost::iostreams::zlib_decompressor() );
+   in.push( file );
+   snapshot_header header;
+   fc::raw::unpack( in, header );
+   graphene::chain::signed_block head_block;
+   fc::raw::unpack( in, head_block );
+   FC_ASSERT( head_block.id() == header.head_block_id, "Snapshot head block does not match its header" );
+
+   // the sections are written in the layout of object_database::open(), complete with the next ids
+   const fc::path tmp_dir = chain_dir / "object_database.tmp";
+   fc::remove_all( tmp_dir );
+   for( uint32_t i = 0; i < header.section_count; ++i )
+   {
+      snapshot_section_header section;
+      fc::raw::unpack( in, section );
+      fc::create_directories( tmp_dir / fc::to_string(section.space_id) );
+      const fc::path index_file = tmp_dir / fc::to_string(section.space_id) / fc::to_string(section.type_id);
+      std::ofstream out( index_file.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+      FC_ASSERT( out, "Failed to create ${f}", ("f",index_file) );
+      fc::raw::pack( out, section.next_id );
+      fc::raw::pack( out, graphene::db::base_primary_index::file_version() );
+
+      fc::sha256::encoder enc;
+      vector<char> data;
+      for( uint64_t n = 0; n < section.object_count; ++n )
+      {
+         fc::raw::unpack( in, data );
+         const auto record = fc::raw::pack( data );
+         enc.write( record.data(), record.size() );
+         out.write( record.data(), record.size() );
+      }
+      fc::sha256 checksum;
+      fc::raw::unpack( in, checksum );
+      FC_ASSERT( in, "Snapshot is truncated" );
+      FC_ASSERT( checksum == enc.result(), "Snapshot section ${s}.${t} is corrupt",
+                 ("s",section.space_id)("t",section.type_id) );
+      out.close();
+      FC_ASSERT( out, "Failed to write ${f}", ("f",index_file) );
+   }
+
+   // Without its head block the node could not tell peers where it stands nor link the next block.
+   // It is stored before the object database appears, which is what marks the snapshot as loaded.
+   graphene::chain::block_database blocks;
+   blocks.open( chain_dir / "database" / "block_num_to_block" );
+   blocks.store( header.head_block_id, head_block );
+   blocks.close();
+
+   fc::rename( tmp_dir, chain_dir / "object_database" );
+   std::ofstream version_file( (chain_dir / "db_version").generic_string().c_str(),
+                               std::ios::out | std::ios::binary | std::ios::trunc );
+   const std::string db_version = GRAPHENE_CURRENT_DB_VERSION;
+   version_file.write( db_version.c_str(), db_version.size() );
+   version_file.close();
+
+   ilog( "snapshot plugin: loaded snapshot of chain ${c} at block ${b}",
+         ("c",header.chain_id)("b",header.head_block_num) );
+   return header;
+} FC_CAPTURE_AND_RETHROW( (snapshot)(chain_dir) ) }
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+    {
+       if( binary )
+          create_binary_snapshot( b );
+       else
+          create_snapshot( database(), dest );
+    }
     last_block = current_block;
     last_time = b.timestamp;
 } FC_LOG_AND_RETHROW() }
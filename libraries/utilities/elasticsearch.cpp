@@ -25,8 +25,15 @@
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
 
 size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
@@ -79,6 +86,162 @@ bool SendBulk(ES& es)
    return false;
 }
 
+ESBulkSender::ESBulkSender(const std::string& elasticsearch_url, const std::string& auth,
+                           uint32_t max_in_flight, uint32_t max_queued, const std::string& spill_dir)
+   : elasticsearch_url(elasticsearch_url), auth(auth), max_queued(std::max(max_queued, 1u)), spill_dir(spill_dir)
+{
+   FC_ASSERT(!spill_dir.empty(), "Sending bulks asynchronously needs a directory to spill them to");
+   boost::filesystem::create_directories(spill_dir);
+   for(uint32_t i = 0; i < std::max(max_in_flight, 1u); ++i)
+      workers.emplace_back([this]() { work(); });
+}
+
+ESBulkSender::~ESBulkSender()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+   }
+   work_ready.notify_all();
+   for(auto& worker : workers)
+      worker.join();
+}
+
+void ESBulkSender::enqueue(std::vector<std::string>&& bulk_lines)
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   if(queue.size() >= max_queued)
+   {
+      // elasticsearch is not keeping up, keep the batch on disk rather than holding up the caller
+      lock.unlock();
+      if(spill(joinBulkLines(bulk_lines)))
+         return;
+      lock.lock();
+   }
+   space_ready.wait(lock, [this]() { return queue.size() < max_queued; });
+   queue.push_back(std::move(bulk_lines));
+   work_ready.notify_one();
+}
+
+void ESBulkSender::flush()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   idle.wait(lock, [this]() { return queue.empty() && in_flight == 0; });
+}
+
+void ESBulkSender::work()
+{
+   static const uint32_t max_attempts = 3;
+
+   CURL* curl = curl_easy_init();
+   std::unique_lock<std::mutex> lock(mutex);
+   while(true)
+   {
+      work_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+      if(queue.empty())
+         break;
+      std::vector<std::string> bulk_lines = std::move(queue.front());
+      queue.pop_front();
+      ++in_flight;
+      space_ready.notify_one();
+      lock.unlock();
+
+      const std::string body = joinBulkLines(bulk_lines);
+      bool done = false;
+      for(uint32_t attempt = 1; !done; ++attempt)
+      {
+         done = post(curl, body);
+         if(done)
+         {
+            ++sent;
+            resendSpilled(curl);
+         }
+         else if(attempt >= max_attempts && spill(body))
+            done = true;
+         else
+            std::this_thread::sleep_for(std::chrono::milliseconds(100 << std::min(attempt, 6u)));
+      }
+
+      lock.lock();
+      --in_flight;
+      idle.notify_all();
+   }
+   lock.unlock();
+   curl_easy_cleanup(curl);
+}
+
+bool ESBulkSender::post(CURL* curl, const std::string& body)
+{
+   try
+   {
+      graphene::utilities::CurlRequest curl_request;
+      curl_request.handler = curl;
+      curl_request.url = elasticsearch_url + "_bulk";
+      curl_request.auth = auth;
+      curl_request.type = "POST";
+      curl_request.query = body;
+
+      auto curlResponse = doCurl(curl_request);
+      return handleBulkResponse(getResponseCode(curl_request.handler), curlResponse);
+   }
+   catch(const fc::exception& e)
+   {
+      elog("Invalid bulk response from elasticsearch: ${e}", ("e", e.to_detail_string()));
+   }
+   return false;
+}
+
+bool ESBulkSender::spill(const std::string& body)
+{
+   // names sort in the order the batches were spilled, also across restarts
+   const std::string name = std::to_string(fc::time_point::now().time_since_epoch().count()) + "-" +
+                            std::to_string(spill_sequence++) + ".json";
+   const boost::filesystem::path file = boost::filesystem::path(spill_dir) / name;
+   const boost::filesystem::path tmp = boost::filesystem::path(spill_dir) / (name + ".tmp");
+   {
+      std::ofstream out(tmp.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+      out.write(body.data(), body.size());
+      if(!out)
+      {
+         elog("Failed to spill bulk request to ${f}", ("f", tmp.string()));
+         return false;
+      }
+   }
+   boost::filesystem::rename(tmp, file);
+   ++spilled;
+   return true;
+}
+
+void ESBulkSender::resendSpilled(CURL* curl)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(resending)
+         return;
+      resending = true;
+   }
+
+   std::vector<boost::filesystem::path> files;
+   for(boost::filesystem::directory_iterator itr(spill_dir), end; itr != end; ++itr)
+      if(itr->path().extension() == ".json")
+         files.push_back(itr->path());
+   std::sort(files.begin(), files.end());
+
+   for(const auto& file : files)
+   {
+      std::ifstream in(file.string(), std::ios::in | std::ios::binary);
+      const std::string body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      in.close();
+      if(!post(curl, body))
+         break;
+      boost::filesystem::remove(file);
+      ++sent;
+   }
+
+   std::lock_guard<std::mutex> lock(mutex);
+   resending = false;
+}
+
 const std::string joinBulkLines(const std::vector<std::string>& bulk)
 {
    auto bulking = boost::algorithm::join(bulk, "\n");
@@ -168,6 +331,8 @@ const std::string doCurl(CurlRequest& curl)
    std::string CurlReadBuffer;
    struct curl_slist *headers = NULL;
    headers = curl_slist_append(headers, "Content-Type: application/json");
+   // do not wait for a 100 Continue before sending larger bodies
+   headers = curl_slist_append(headers, "Expect:");
 
    curl_easy_setopt(curl.handler, CURLOPT_HTTPHEADER, headers);
    curl_easy_setopt(curl.handler, CURLOPT_URL, curl.url.c_str());
@@ -183,6 +348,8 @@ const std::string doCurl(CurlRequest& curl)
    if(!curl.auth.empty())
       curl_easy_setopt(curl.handler, CURLOPT_USERPWD, curl.auth.c_str());
    curl_easy_perform(curl.handler);
+   curl_easy_setopt(curl.handler, CURLOPT_HTTPHEADER, NULL);
+   curl_slist_free_all(headers);
 
    return CurlReadBuffer;
 }
@@ -22,8 +22,13 @@
  * THE SOFTWARE.
  */
 #pragma once
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <curl/curl.h>
@@ -53,6 +58,55 @@ namespace graphene { namespace utilities {
          std::string query;
    };
 
+   /**
+    * Posts bulk requests to elasticsearch from background threads.
+    *
+    * Batches of bulk lines are queued by enqueue() and posted by up to max_in_flight workers, each
+    * with its own curl handle.  Failed requests are retried.  Batches that keep failing and batches
+    * that find the queue full are written to the spill directory instead, and posted again after the
+    * next request goes through.  An accepted batch is never dropped: if it cannot be spilled either,
+    * it is retried until it is sent, also while shutting down.
+    */
+   class ESBulkSender {
+      public:
+         ESBulkSender(const std::string& elasticsearch_url, const std::string& auth,
+                      uint32_t max_in_flight, uint32_t max_queued, const std::string& spill_dir);
+         /// sends or spills everything still queued
+         ~ESBulkSender();
+
+         void enqueue(std::vector<std::string>&& bulk_lines);
+         /// waits until all queued batches have been sent or spilled
+         void flush();
+
+         uint64_t sentCount()const { return sent; }
+         uint64_t spilledCount()const { return spilled; }
+
+      private:
+         void work();
+         bool post(CURL* curl, const std::string& body);
+         /// @return false if the batch could not be written
+         bool spill(const std::string& body);
+         void resendSpilled(CURL* curl);
+
+         const std::string elasticsearch_url;
+         const std::string auth;
+         const uint32_t max_queued;
+         const std::string spill_dir;
+
+         std::mutex mutex;
+         std::condition_variable work_ready;
+         std::condition_variable space_ready;
+         std::condition_variable idle;
+         std::deque<std::vector<std::string>> queue;
+         uint32_t in_flight = 0;
+         bool resending = false;
+         std::atomic<bool> stopping{false};
+         std::atomic<uint64_t> sent{0};
+         std::atomic<uint64_t> spilled{0};
+         std::atomic<uint64_t> spill_sequence{0};
+         std::vector<std::thread> workers;
+   };
+
    bool SendBulk(ES& es);
    const std::vector<std::string> createBulk(const fc::mutable_variant_object& bulk_header, const std::string& data);
    bool checkES(ES& es);
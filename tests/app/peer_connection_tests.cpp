@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/net/peer_connection.hpp>
+#include <graphene/net/core_messages.hpp>
+
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace graphene::net;
+
+namespace
+{
+   /** answers every item with an item_not_available_message, but only once released, and records what it receives */
+   class blocking_delegate : public peer_connection_delegate
+   {
+   public:
+      fc::promise<void>::ptr release = fc::promise<void>::ptr( new fc::promise<void>( "blocking_delegate::release" ) );
+      bool waiting = false;
+      std::vector<message> received_messages;
+
+      void on_message( peer_connection* originating_peer, const message& received_message ) override
+      {
+         received_messages.push_back( received_message );
+      }
+      void on_connection_closed( peer_connection* originating_peer ) override {}
+      std::shared_ptr<const message> get_message_for_item( item_id item ) override
+      {
+         waiting = true;
+         fc::future<void>( release ).wait();
+         waiting = false;
+         return std::make_shared<message>( item_not_available_message( item ) );
+      }
+   };
+
+   item_id make_item_id( int i )
+   {
+      return item_id( trx_message_type, fc::ripemd160::hash( fc::to_string( i ) ) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( send_queue_grows_while_generating_a_message )
+{
+   try {
+      blocking_delegate sender_delegate;
+      blocking_delegate receiver_delegate;
+      fc::tcp_server server;
+      server.listen( 0 );
+      peer_connection_ptr receiver = peer_connection::make_shared( &receiver_delegate );
+      peer_connection_ptr sender = peer_connection::make_shared( &sender_delegate );
+
+      fc::future<void> accepted = fc::async( [&]() {
+         server.accept( receiver->get_socket() );
+         receiver->accept_connection();
+      }, "accept" );
+      sender->connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), server.get_port() ) );
+      accepted.wait();
+
+      // park the send task inside the delegate while it generates the first message
+      sender->send_item( make_item_id( 0 ) );
+      for( int i = 0; i < 100 && !sender_delegate.waiting; ++i )
+         fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE( sender_delegate.waiting );
+
+      // queue enough behind it that the queue has to be reallocated, twice
+      const int item_count = 40;
+      for( int i = 1; i < item_count; ++i )
+         sender->send_item( make_item_id( i ) );
+      std::shared_ptr<const message> shared_message = std::make_shared<message>( address_request_message() );
+      sender->send_shared_message( shared_message );
+      sender->send_shared_message( shared_message );
+
+      const size_t queued_count = item_count + 2;
+      BOOST_CHECK_EQUAL( sender->get_queued_messages_count(), queued_count );
+      BOOST_CHECK_EQUAL( sender->get_queued_messages_size(), item_count * sizeof(item_id) + 2 * shared_message->data.size() );
+      BOOST_CHECK_EQUAL( sender->get_max_queued_messages_count(), queued_count );
+
+      sender_delegate.release->set_value();
+      for( int i = 0; i < 500 && receiver_delegate.received_messages.size() < queued_count; ++i )
+         fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE_EQUAL( receiver_delegate.received_messages.size(), queued_count );
+
+      for( int i = 0; i < item_count; ++i )
+      {
+         const message& received = receiver_delegate.received_messages[i];
+         BOOST_REQUIRE_EQUAL( received.msg_type, uint32_t( item_not_available_message_type ) );
+         BOOST_CHECK( received.as<item_not_available_message>().requested_item == make_item_id( i ) );
+      }
+      for( int i = item_count; i < int( queued_count ); ++i )
+      {
+         BOOST_CHECK_EQUAL( receiver_delegate.received_messages[i].msg_type, uint32_t( address_request_message_type ) );
+         BOOST_CHECK( receiver_delegate.received_messages[i].data == shared_message->data );
+      }
+
+      BOOST_CHECK_EQUAL( sender->get_queued_messages_count(), 0u );
+      BOOST_CHECK_EQUAL( sender->get_queued_messages_size(), 0u );
+      BOOST_CHECK_EQUAL( sender->get_max_queued_messages_count(), queued_count );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
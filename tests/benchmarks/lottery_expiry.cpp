@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/asset_object.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+
+BOOST_FIXTURE_TEST_CASE( lottery_expiry_bench, database_fixture )
+{
+   try {
+      const int lottery_count = 10000;
+#ifdef NDEBUG
+      const int checks = 10000;
+#else
+      const int checks = 1000;
+#endif
+
+      const time_point_sec first_end = db.head_block_time() + fc::days(30);
+      for( int i = 0; i < lottery_count; ++i )
+      {
+         const auto& dynamic_data = db.create<asset_dynamic_data_object>( []( asset_dynamic_data_object& ){} );
+         db.create<asset_object>( [&]( asset_object& a ) {
+            a.symbol = "LOTTERY" + fc::to_string( i );
+            a.issuer = account_id_type();
+            a.dynamic_asset_data_id = dynamic_data.id;
+            lottery_asset_options options;
+            options.end_date = first_end + uint32_t( i );
+            options.is_active = true;
+            a.lottery_options = options;
+         });
+      }
+
+      const auto& lotteries_idx = db.get_index_type<asset_index>().indices().get<by_lottery_expiration>();
+      auto count_active = [&]() {
+         auto range = lotteries_idx.equal_range( boost::make_tuple( true ) );
+         return size_t( std::distance( range.first, range.second ) );
+      };
+      BOOST_REQUIRE_EQUAL( count_active(), size_t( lottery_count ) );
+
+      fc::time_point start = fc::time_point::now();
+      for( int i = 0; i < checks; ++i )
+         db.check_ending_lotteries();
+      auto elapsed = fc::time_point::now() - start;
+      ilog( "Checked ${n} active lotteries for expiry ${c} times in ${t} us (${p} us per block)",
+            ("n", lottery_count)("c", checks)("t", elapsed.count())("p", double(elapsed.count()) / checks) );
+
+      // what every block used to pay: a full walk of the active lotteries, copying each one
+      const auto& active_idx = db.get_index_type<asset_index>().indices().get<active_lotteries>();
+      uint64_t pending = 0;
+      start = fc::time_point::now();
+      for( int i = 0; i < checks; ++i )
+         for( auto checking_asset : active_idx )
+         {
+            if( !checking_asset.is_active_lottery() ) break;
+            if( checking_asset.lottery_options->end_date > db.head_block_time() ) { ++pending; continue; }
+         }
+      elapsed = fc::time_point::now() - start;
+      ilog( "Scanned ${n} active lotteries ${c} times in ${t} us (${p} us per block)",
+            ("n", lottery_count)("c", checks)("t", elapsed.count())("p", double(elapsed.count()) / checks) );
+      BOOST_CHECK_EQUAL( pending, uint64_t(lottery_count) * checks );
+
+      BOOST_CHECK_EQUAL( count_active(), size_t( lottery_count ) );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/stcp_socket.hpp>
+
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace graphene::net;
+
+namespace {
+
+class counting_delegate : public message_oriented_connection_delegate
+{
+public:
+   uint64_t               bytes_received = 0;
+   uint32_t               messages_received = 0;
+   uint32_t               messages_expected = 0;
+   fc::promise<void>::ptr all_received;
+
+   void on_message( message_oriented_connection*, const message& received_message ) override
+   {
+      bytes_received += received_message.data.size();
+      if( ++messages_received == messages_expected )
+         all_received->set_value();
+   }
+   void on_connection_closed( message_oriented_connection* ) override {}
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( stcp_throughput_bench )
+{
+   try {
+      const uint32_t message_size = 1024 * 1024;
+#ifdef NDEBUG
+      const uint32_t message_count = 256;
+#else
+      const uint32_t message_count = 32;
+#endif
+
+      fc::tcp_server server;
+      server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+
+      counting_delegate receiver_delegate;
+      message_oriented_connection receiver( &receiver_delegate );
+      message_oriented_connection sender;
+      fc::future<void> accepted = fc::async( [&]() {
+         server.accept( receiver.get_socket() );
+         receiver.accept();
+      }, "stcp_throughput_bench accept" );
+      sender.connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), server.get_port() ) );
+      accepted.wait();
+
+      message payload;
+      payload.msg_type = 1;
+      payload.data.resize( message_size, 'x' );
+      payload.size = message_size;
+
+      for( bool offload : { false, true } )
+      {
+         stcp_socket::enable_cipher_offload( offload );
+         receiver_delegate.bytes_received = 0;
+         receiver_delegate.messages_received = 0;
+         receiver_delegate.messages_expected = message_count;
+         receiver_delegate.all_received = fc::promise<void>::ptr( new fc::promise<void>( "stcp_throughput_bench" ) );
+
+         fc::time_point start = fc::time_point::now();
+         for( uint32_t i = 0; i < message_count; ++i )
+            sender.send_message( payload );
+         receiver_delegate.all_received->wait();
+         auto elapsed = fc::time_point::now() - start;
+
+         BOOST_CHECK_EQUAL( receiver_delegate.bytes_received, uint64_t( message_size ) * message_count );
+         ilog( "Sent ${n} messages of ${s} bytes over one loopback connection in ${t} us, ${r} MB/s (cipher offload ${o})",
+               ("n", message_count)("s", message_size)("t", elapsed.count())
+               ("r", double( receiver_delegate.bytes_received ) / elapsed.count())("o", offload) );
+      }
+      stcp_socket::enable_cipher_offload( false );
+
+      sender.destroy_connection();
+      receiver.destroy_connection();
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -415,6 +415,84 @@ BOOST_AUTO_TEST_CASE(binned_order_books)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(events_containing_sub_string)
+{
+   try
+   {
+      CREATE_ICE_HOCKEY_BETTING_MARKET(false, 0);
+
+      graphene::bookie::bookie_api bookie_api(app);
+
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("capitals", "en").size(), 1u);
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("CHICAGO", "en").size(), 1u);
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("s/c", "en").size(), 1u);
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("ca", "en").size(), 1u);
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("芝加哥", "zh_Hans").size(), 1u);
+      BOOST_CHECK(bookie_api.get_events_containing_sub_string("capitals chicago", "en").empty());
+      BOOST_CHECK(bookie_api.get_events_containing_sub_string("capitals", "fr").empty());
+
+      fc::optional<internationalized_string_type> name = internationalized_string_type({{"en", "Washington Capitals/St. Louis Blues"}});
+      update_event(capitals_vs_blackhawks.id, _name = name);
+      generate_blocks(1);
+
+      BOOST_CHECK(bookie_api.get_events_containing_sub_string("chicago", "en").empty());
+      BOOST_CHECK(bookie_api.get_events_containing_sub_string("芝加哥", "zh_Hans").empty());
+      BOOST_CHECK_EQUAL(bookie_api.get_events_containing_sub_string("louis", "en").size(), 1u);
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(bet_price_levels)
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      CREATE_ICE_HOCKEY_BETTING_MARKET(false, 0);
+
+      transfer(account_id_type(), alice_id, asset(10000));
+      transfer(account_id_type(), bob_id, asset(10000));
+
+      const auto& price_levels = db.get_index_type<primary_index<bet_object_index>>().get_secondary_index<bet_price_level_index>();
+      const bet_multiplier_type odds_1_6 = 16 * GRAPHENE_BETTING_ODDS_PRECISION / 10;
+      const bet_multiplier_type odds_1_65 = 165 * GRAPHENE_BETTING_ODDS_PRECISION / 100;
+
+      // two bets at the same odds share a level
+      place_bet(bob_id, capitals_win_market.id, bet_type::back, asset(100, asset_id_type()), odds_1_6);
+      place_bet(bob_id, capitals_win_market.id, bet_type::back, asset(100, asset_id_type()), odds_1_6);
+      place_bet(bob_id, capitals_win_market.id, bet_type::back, asset(100, asset_id_type()), odds_1_65);
+
+      BOOST_CHECK(price_levels.get_levels(capitals_win_market.id, bet_type::lay) == nullptr);
+      const auto* back_levels = price_levels.get_levels(capitals_win_market.id, bet_type::back);
+      BOOST_REQUIRE(back_levels != nullptr);
+      BOOST_REQUIRE_EQUAL(back_levels->size(), 2u);
+      BOOST_CHECK_EQUAL(back_levels->at(odds_1_6).amount_to_bet.value, 200);
+      BOOST_CHECK_EQUAL(back_levels->at(odds_1_6).bet_count, 2u);
+      BOOST_CHECK_EQUAL(back_levels->at(odds_1_65).amount_to_bet.value, 100);
+      BOOST_CHECK_EQUAL(back_levels->at(odds_1_65).bet_count, 1u);
+
+      // consuming the bets at 1.6 removes their level, the rest of the book is unchanged
+      share_type lay_amount = bet_object::get_approximate_matching_amount(200, odds_1_6, bet_type::back, true /* round up */);
+      place_bet(alice_id, capitals_win_market.id, bet_type::lay, asset(lay_amount, asset_id_type()), odds_1_6);
+
+      BOOST_CHECK(price_levels.get_levels(capitals_win_market.id, bet_type::lay) == nullptr);
+      back_levels = price_levels.get_levels(capitals_win_market.id, bet_type::back);
+      BOOST_REQUIRE(back_levels != nullptr);
+      BOOST_REQUIRE_EQUAL(back_levels->size(), 1u);
+      BOOST_CHECK_EQUAL(back_levels->begin()->first, odds_1_65);
+      BOOST_CHECK_EQUAL(back_levels->begin()->second.amount_to_bet.value, 100);
+
+      // the levels follow the bets when changes are undone
+      {
+         auto session = db._undo_db.start_undo_session();
+         const bet_object& remaining_bet = *db.get_index_type<bet_object_index>().indices().get<by_odds>().lower_bound(std::make_tuple(capitals_win_market.id));
+         db.cancel_bet(remaining_bet, true);
+         BOOST_CHECK(price_levels.get_levels(capitals_win_market.id, bet_type::back) == nullptr);
+      }
+      back_levels = price_levels.get_levels(capitals_win_market.id, bet_type::back);
+      BOOST_REQUIRE(back_levels != nullptr);
+      BOOST_CHECK_EQUAL(back_levels->begin()->second.amount_to_bet.value, 100);
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( peerplays_sport_create_test )
 {
    try
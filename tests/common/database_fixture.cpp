@@ -177,6 +177,9 @@ database_fixture::database_fixture()
       esobjects_plugin->plugin_startup();
    }
 
+   if( test_name == "market_ticker_rolling_window" )
+      options.insert(std::make_pair("bucket-size", boost::program_options::variable_value(string("[15,60,300,3600,86400]"), false)));
+
    mhplugin->plugin_set_app(&app);
    mhplugin->plugin_initialize(options);
    bookieplugin->plugin_set_app(&app);
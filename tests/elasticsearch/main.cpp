@@ -31,6 +31,9 @@
 
 #include "../common/database_fixture.hpp"
 
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/asio.hpp>
+
 #define BOOST_TEST_MODULE Elastic Search Database Tests
 #include <boost/test/included/unit_test.hpp>
 
@@ -533,3 +536,191 @@ BOOST_AUTO_TEST_CASE(elasticsearch_history_api) {
    }
 }
 BOOST_AUTO_TEST_SUITE_END()
+
+namespace {
+
+/// answers every bulk request after a fixed delay, standing in for a slow elasticsearch node
+class stub_es_server
+{
+   public:
+      stub_es_server( std::chrono::milliseconds delay )
+      : _acceptor( _io, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) ), _delay( delay )
+      {
+         _thread = std::thread( [this]() { accept_loop(); } );
+      }
+
+      ~stub_es_server()
+      {
+         _stopping = true;
+         // wake up the acceptor
+         boost::asio::ip::tcp::socket socket( _io );
+         boost::system::error_code ec;
+         socket.connect( _acceptor.local_endpoint(), ec );
+         _thread.join();
+         for( auto& t : _connections )
+            t.join();
+      }
+
+      std::string url()const { return "http://127.0.0.1:" + std::to_string( _acceptor.local_endpoint().port() ) + "/"; }
+
+      std::atomic<uint32_t> requests{0};
+      std::atomic<uint32_t> status{200};
+      /// most requests that were being answered at the same time
+      std::atomic<uint32_t> max_concurrent{0};
+
+   private:
+      void accept_loop()
+      {
+         while( !_stopping )
+         {
+            auto socket = std::make_shared<boost::asio::ip::tcp::socket>( _io );
+            boost::system::error_code ec;
+            _acceptor.accept( *socket, ec );
+            if( ec || _stopping )
+               break;
+            _connections.emplace_back( [this,socket]() { serve( *socket ); } );
+         }
+      }
+
+      void serve( boost::asio::ip::tcp::socket& socket )
+      {
+         boost::system::error_code ec;
+         boost::asio::streambuf buffer;
+         while( true )
+         {
+            boost::asio::read_until( socket, buffer, "\r\n\r\n", ec );
+            if( ec )
+               return;
+            std::istream in( &buffer );
+            std::string line;
+            size_t content_length = 0;
+            while( std::getline( in, line ) && line != "\r" )
+            {
+               boost::algorithm::to_lower( line );
+               if( line.find( "content-length:" ) == 0 )
+                  content_length = std::stoul( line.substr( 15 ) );
+            }
+            if( buffer.size() < content_length )
+               boost::asio::read( socket, buffer, boost::asio::transfer_exactly( content_length - buffer.size() ), ec );
+            buffer.consume( content_length );
+            if( ec )
+               return;
+
+            const uint32_t concurrent = ++_concurrent;
+            uint32_t seen = max_concurrent.load();
+            while( concurrent > seen && !max_concurrent.compare_exchange_weak( seen, concurrent ) );
+            std::this_thread::sleep_for( _delay );
+            --_concurrent;
+            ++requests;
+            const std::string body = "{\"errors\":false}";
+            const std::string response = "HTTP/1.1 " + std::to_string( status.load() ) + " Stub\r\n"
+                                         "Content-Type: application/json\r\n"
+                                         "Content-Length: " + std::to_string( body.size() ) + "\r\n\r\n" + body;
+            boost::asio::write( socket, boost::asio::buffer( response ), ec );
+            if( ec )
+               return;
+         }
+      }
+
+      boost::asio::io_service         _io;
+      boost::asio::ip::tcp::acceptor  _acceptor;
+      std::chrono::milliseconds       _delay;
+      std::atomic<bool>               _stopping{false};
+      std::atomic<uint32_t>           _concurrent{0};
+      std::thread                     _thread;
+      std::vector<std::thread>        _connections;
+};
+
+std::vector<std::string> stub_bulk( uint32_t n )
+{
+   fc::mutable_variant_object header;
+   header["_index"] = "peerplays-test";
+   header["_type"] = "data";
+   header["_id"] = fc::to_string( n );
+   return graphene::utilities::createBulk( header, "{\"n\":" + fc::to_string( n ) + "}" );
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE( elasticsearch_bulk_sender_tests )
+
+BOOST_AUTO_TEST_CASE(elasticsearch_bulk_sender_in_flight) {
+   try {
+      stub_es_server server( std::chrono::milliseconds( 50 ) );
+      fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+      const uint32_t bulks = 20;
+
+      auto send_all = [&]( uint32_t max_in_flight ) {
+         server.max_concurrent = 0;
+         graphene::utilities::ESBulkSender sender( server.url(), "", max_in_flight, 4, spill_dir.path().string() );
+         for( uint32_t i = 0; i < bulks; ++i )
+            sender.enqueue( stub_bulk( i ) );
+         sender.flush();
+         BOOST_CHECK_EQUAL( sender.sentCount(), bulks );
+         BOOST_CHECK_EQUAL( sender.spilledCount(), 0u );
+         return server.max_concurrent.load();
+      };
+
+      BOOST_CHECK_EQUAL( send_all( 1 ), 1u );
+      BOOST_CHECK_EQUAL( send_all( 4 ), 4u );
+      BOOST_CHECK_EQUAL( server.requests.load(), 2 * bulks );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(elasticsearch_bulk_sender_spill) {
+   try {
+      stub_es_server server( std::chrono::milliseconds( 0 ) );
+      fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+      auto spilled_files = [&]() {
+         return std::distance( boost::filesystem::directory_iterator( spill_dir.path() ), boost::filesystem::directory_iterator() );
+      };
+
+      graphene::utilities::ESBulkSender sender( server.url(), "", 2, 4, spill_dir.path().string() );
+
+      // elasticsearch refuses everything, the bulks end up on disk
+      server.status = 500;
+      sender.enqueue( stub_bulk( 1 ) );
+      sender.enqueue( stub_bulk( 2 ) );
+      sender.flush();
+      BOOST_CHECK_EQUAL( sender.spilledCount(), 2u );
+      BOOST_CHECK_EQUAL( spilled_files(), 2 );
+
+      // the next bulk that goes through takes the spilled ones along
+      server.status = 200;
+      sender.enqueue( stub_bulk( 3 ) );
+      sender.flush();
+      BOOST_CHECK_EQUAL( sender.sentCount(), 3u );
+      BOOST_CHECK_EQUAL( spilled_files(), 0 );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(elasticsearch_bulk_sender_shutdown) {
+   try {
+      stub_es_server server( std::chrono::milliseconds( 0 ) );
+      fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+
+      BOOST_CHECK_THROW( graphene::utilities::ESBulkSender( server.url(), "", 1, 4, "" ), fc::exception );
+
+      // bulks elasticsearch refuses until shutdown are kept on disk, not dropped
+      server.status = 500;
+      {
+         graphene::utilities::ESBulkSender sender( server.url(), "", 2, 4, spill_dir.path().string() );
+         for( uint32_t i = 0; i < 6; ++i )
+            sender.enqueue( stub_bulk( i ) );
+      }
+      const auto spilled = std::distance( boost::filesystem::directory_iterator( spill_dir.path() ),
+                                          boost::filesystem::directory_iterator() );
+      BOOST_CHECK_EQUAL( spilled, 6 );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -34,6 +34,11 @@
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/net/peer_database.hpp>
+#include <graphene/net/config.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
 #include <fc/crypto/hash_ctr_rng.hpp>
@@ -555,4 +560,51 @@ BOOST_AUTO_TEST_CASE( bitasset_feed_expiration_test )
    BOOST_CHECK( !o.feed_is_expired( now ) );
 }
 
+BOOST_AUTO_TEST_CASE( peer_database_persistence )
+{
+   using namespace graphene::net;
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path filename = data_dir.path() / "peers.dat";
+   auto endpoint = []( uint16_t port ) { return fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), port ); };
+   const fc::time_point_sec now( 1500000000 );
+
+   peer_database writer;
+   writer.open( filename );
+   for( uint16_t port = 1; port <= 4; ++port )
+      writer.update_entry( potential_peer_record( endpoint( port ), now + port ) );
+   potential_peer_record failing = writer.lookup_or_create_entry_for_endpoint( endpoint( 4 ) );
+   failing.number_of_failed_connection_attempts = 3;
+   writer.update_entry( failing );
+   writer.erase( endpoint( 2 ) );
+
+   // the writer is neither closed nor destroyed, as after a crash: what it appended so far must
+   // already be in the file and be enough to restore the database
+   peer_database peers;
+   peers.open( filename );
+   BOOST_CHECK_EQUAL( peers.size(), 3u );
+   BOOST_CHECK( !peers.lookup_entry_for_endpoint( endpoint( 2 ) ) );
+   BOOST_CHECK_EQUAL( peers.lookup_entry_for_endpoint( endpoint( 4 ) )->number_of_failed_connection_attempts, 3u );
+
+   // most recently seen first, peers that failed last
+   std::vector<uint16_t> by_last_seen;
+   for( auto itr = peers.begin(); itr != peers.end(); ++itr )
+      by_last_seen.push_back( itr->endpoint.port() );
+   BOOST_CHECK( by_last_seen == std::vector<uint16_t>({ 4, 3, 1 }) );
+   std::vector<uint16_t> candidates;
+   for( auto itr = peers.begin_connection_candidates(); itr != peers.end_connection_candidates(); ++itr )
+      candidates.push_back( itr->endpoint.port() );
+   BOOST_CHECK( candidates == std::vector<uint16_t>({ 3, 1, 4 }) );
+
+   // the database never grows past its limit, dropping the peers seen longest ago
+   for( uint16_t port = 100; port < 100 + MAXIMUM_PEERDB_SIZE; ++port )
+      peers.update_entry( potential_peer_record( endpoint( port ), now + port ) );
+   BOOST_CHECK_EQUAL( peers.size(), size_t( MAXIMUM_PEERDB_SIZE ) );
+   BOOST_CHECK( !peers.lookup_entry_for_endpoint( endpoint( 1 ) ) );
+   peers.close();
+
+   peer_database reopened;
+   reopened.open( filename );
+   BOOST_CHECK_EQUAL( reopened.size(), size_t( MAXIMUM_PEERDB_SIZE ) );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
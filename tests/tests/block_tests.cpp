@@ -35,6 +35,10 @@
 #include <graphene/chain/witness_schedule_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
+#include <graphene/app/block_message_cache.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/snapshot/snapshot.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -127,6 +131,76 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( block_database_mmap_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.enable_mmap_reads( true );
+      bdb.open( data_dir.path() );
+      FC_ASSERT( bdb.mmap_reads_enabled() );
+
+      signed_block b;
+      vector<block_id_type> ids;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         bdb.store( b.id(), b );
+         ids.push_back( b.id() );
+
+         // every store grows the files past the current mappings
+         auto fetch = bdb.fetch_by_number( b.block_num() );
+         FC_ASSERT( fetch.valid() );
+         FC_ASSERT( fetch->witness == b.witness );
+         fetch = bdb.fetch_optional( b.id() );
+         FC_ASSERT( fetch.valid() );
+         FC_ASSERT( fetch->witness == b.witness );
+         FC_ASSERT( bdb.contains( b.id() ) );
+         FC_ASSERT( bdb.fetch_block_id( b.block_num() ) == b.id() );
+         auto packed = bdb.fetch_packed( b.id() );
+         FC_ASSERT( packed.valid() );
+         FC_ASSERT( *packed == fc::raw::pack( b ) );
+      }
+
+      FC_ASSERT( !bdb.fetch_by_number( 6 ).valid() );
+
+      bdb.remove( ids.back() );
+      FC_ASSERT( !bdb.contains( ids.back() ) );
+      FC_ASSERT( !bdb.fetch_optional( ids.back() ).valid() );
+      FC_ASSERT( !bdb.fetch_packed( ids.back() ).valid() );
+      FC_ASSERT( bdb.contains( ids.front() ) );
+
+      auto last = bdb.last();
+      FC_ASSERT( last );
+      FC_ASSERT( last->id() == ids[3] );
+
+      bdb.close();
+      bdb.open( data_dir.path() );
+      for( uint32_t i = 0; i < 4; ++i )
+      {
+         auto blk = bdb.fetch_by_number( i+1 );
+         FC_ASSERT( blk.valid() );
+         FC_ASSERT( blk->id() == ids[i] );
+      }
+
+      bdb.close();
+      bdb.enable_mmap_reads( false );
+      bdb.open( data_dir.path() );
+      for( uint32_t i = 0; i < 4; ++i )
+      {
+         auto packed = bdb.fetch_packed( ids[i] );
+         FC_ASSERT( packed.valid() );
+         FC_ASSERT( fc::raw::unpack<signed_block>( *packed ).id() == ids[i] );
+      }
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -234,6 +308,97 @@ BOOST_AUTO_TEST_CASE( undo_block )
    }
 }
 
+BOOST_AUTO_TEST_CASE( bootstrap_from_binary_snapshot )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      fc::temp_directory snapshot_dir( graphene::utilities::temp_directory_path() );
+      const fc::path snapshot = snapshot_dir.path() / "snapshot.bin";
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      database db1;
+      db1.open(data_dir1.path(), make_genesis, "TEST");
+      for( uint32_t i = 0; i < 10; ++i )
+         db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      graphene::snapshot_plugin::save_binary_snapshot( db1, *db1.fetch_block_by_number( db1.head_block_num() ), snapshot );
+
+      // a fresh data directory, with nothing but the snapshot
+      const auto header = graphene::snapshot_plugin::load_binary_snapshot( snapshot, data_dir2.path() );
+      BOOST_CHECK( header.head_block_id == db1.head_block_id() );
+      database db2;
+      db2.open(data_dir2.path(), []{ return genesis_state_type(); }, GRAPHENE_CURRENT_DB_VERSION);
+      BOOST_CHECK_EQUAL( db1.head_block_num(), db2.head_block_num() );
+      BOOST_CHECK( db2.head_block_id() == db1.head_block_id() );
+      BOOST_CHECK( db2.get_chain_id() == db1.get_chain_id() );
+
+      // a blockchain synopsis is made of the ids from the last block that cannot be undone up to the head
+      vector<block_id_type> synopsis;
+      for( uint32_t num = std::max( 1u, db2.last_non_undoable_block_num() ); num <= db2.head_block_num(); ++num )
+         synopsis.push_back( db2.get_block_id_for_num( num ) );
+      BOOST_REQUIRE( !synopsis.empty() );
+      BOOST_CHECK( synopsis.back() == db1.head_block_id() );
+      BOOST_CHECK( db2.is_known_block( db1.head_block_id() ) );
+
+      const signed_block b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db2, b );
+      BOOST_CHECK( db2.head_block_id() == b.id() );
+      BOOST_CHECK( db2.get_block_id_for_num( b.block_num() ) == b.id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_message_cache_test )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      database db1;
+      db1.open(data_dir1.path(), make_genesis, "TEST");
+      database db2;
+      db2.open(data_dir2.path(), make_genesis, "TEST");
+      signed_block stored_block;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         stored_block = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         PUSH_BLOCK( db2, stored_block );
+      }
+
+      // both extend the chain by a different block of the same height, db1 stays on its own one
+      const signed_block fork_block = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      const signed_block head_block = db1.generate_block(db1.get_slot_time(2), db1.get_scheduled_witness(2), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db1, fork_block );
+      BOOST_CHECK( db1.head_block_id() == head_block.id() );
+      BOOST_CHECK( db1.is_known_block( fork_block.id() ) );
+      BOOST_CHECK( db1.get_block_id_for_num( fork_block.block_num() ) != fork_block.id() );
+
+      graphene::app::block_message_cache cache;
+      for( const signed_block* b : { &stored_block, &head_block, &fork_block } )
+      {
+         const graphene::net::message expected( graphene::net::block_message( *b ) );
+         // the second request is served from the cache
+         for( uint32_t i = 0; i < 2; ++i )
+         {
+            const graphene::net::message served = cache.get_block_message( db1, b->id() );
+            BOOST_CHECK_EQUAL( expected.msg_type, served.msg_type );
+            BOOST_CHECK_EQUAL( expected.size, served.size );
+            BOOST_CHECK( served.data == expected.data );
+            BOOST_CHECK( served.as<graphene::net::block_message>().block_id == b->id() );
+         }
+      }
+      BOOST_CHECK_EQUAL( 3u, cache.size() );
+      cache.set_capacity( 2 );
+      BOOST_CHECK_EQUAL( 2u, cache.size() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( fork_blocks )
 {
    try {
@@ -596,12 +761,16 @@ BOOST_AUTO_TEST_CASE( duplicate_transactions )
       PUSH_TX( db1, trx, skip_sigs );
 
       GRAPHENE_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
+      BOOST_CHECK( db1.get_recent_transaction( trx.id() ).id() == trx.id() );
 
       auto b = db1.generate_block( db1.get_slot_time(1), db1.get_scheduled_witness( 1 ), init_account_priv_key, skip_sigs );
       PUSH_BLOCK( db2, b, skip_sigs );
 
       GRAPHENE_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
       GRAPHENE_CHECK_THROW(PUSH_TX( db2, trx, skip_sigs ), fc::exception);
+      // the transaction body is now read back from the block that included it
+      BOOST_CHECK( db1.get_recent_transaction( trx.id() ).id() == trx.id() );
+      BOOST_CHECK( db2.get_recent_transaction( trx.id() ).id() == trx.id() );
       BOOST_CHECK_EQUAL(db1.get_balance(nathan_id, asset_id_type()).amount.value, 500);
       BOOST_CHECK_EQUAL(db2.get_balance(nathan_id, asset_id_type()).amount.value, 500);
    } catch (fc::exception& e) {
@@ -1307,6 +1476,36 @@ BOOST_FIXTURE_TEST_CASE( transaction_invalidated_in_cache, database_fixture )
 }
 */
 
+BOOST_FIXTURE_TEST_CASE( pending_transactions_stats_test, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      generate_block();
+
+      transfer( account_id_type(), alice_id, asset( 1000 ) );
+      transfer( account_id_type(), bob_id, asset( 1000 ) );
+
+      pending_transactions_stats before = db.get_pending_transactions_stats();
+      BOOST_CHECK_EQUAL( before.pending_count, 2u );
+
+      generate_block();
+
+      // both transfers are applied again while generating the block, then dropped from the pool as known
+      pending_transactions_stats after = db.get_pending_transactions_stats();
+      BOOST_CHECK_EQUAL( after.pending_count, 0u );
+      BOOST_CHECK_EQUAL( after.reapplied, before.reapplied + 2 );
+      BOOST_CHECK_EQUAL( after.dropped, before.dropped );
+      BOOST_CHECK_EQUAL( after.rebuilds, before.rebuilds + 2 );
+      BOOST_CHECK( after.total_rebuild_time >= before.total_rebuild_time );
+   }
+   catch( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( genesis_reserve_ids )
 {
    try
@@ -68,4 +68,96 @@ BOOST_FIXTURE_TEST_SUITE(database_api_tests, database_fixture)
       } FC_LOG_AND_RETHROW()
   }
 
+  BOOST_AUTO_TEST_CASE(market_ticker_rolling_window) {
+      try {
+          ACTORS((nathan)(dan));
+          const auto& tick = create_user_issued_asset( "TICK" );
+          const asset_id_type tick_id = tick.id;
+          fund( nathan, asset(100000) );
+          issue_uia( dan, tick.amount(10000) );
+
+          create_sell_order( nathan_id, asset(1000), asset(500, tick_id) );
+          create_sell_order( dan_id, asset(500, tick_id), asset(1000) );
+          generate_block();
+
+          graphene::app::database_api db_api(db);
+
+          auto ticker = db_api.get_ticker( GRAPHENE_SYMBOL, "TICK" );
+          BOOST_CHECK_CLOSE( ticker.latest, 0.002, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.base_volume, 0.01, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.quote_volume, 5, 0.0001 );
+          BOOST_CHECK_EQUAL( ticker.percent_change, 0 );
+
+          // the ticker is kept for one orientation only, the other one is derived from it
+          ticker = db_api.get_ticker( "TICK", GRAPHENE_SYMBOL );
+          BOOST_CHECK_CLOSE( ticker.latest, 500, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.base_volume, 5, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.quote_volume, 0.01, 0.0001 );
+
+          // once the trade has left the window only the latest price remains
+          generate_blocks( db.head_block_time() + fc::days(1) + fc::minutes(10) );
+          set_expiration( db, trx );
+          ticker = db_api.get_ticker( GRAPHENE_SYMBOL, "TICK" );
+          BOOST_CHECK_CLOSE( ticker.latest, 0.002, 0.0001 );
+          BOOST_CHECK_EQUAL( ticker.base_volume, 0 );
+          BOOST_CHECK_EQUAL( ticker.quote_volume, 0 );
+          BOOST_CHECK_EQUAL( ticker.percent_change, 0 );
+
+          create_sell_order( nathan_id, asset(1000), asset(250, tick_id) );
+          create_sell_order( dan_id, asset(250, tick_id), asset(1000) );
+          generate_block();
+
+          ticker = db_api.get_ticker( GRAPHENE_SYMBOL, "TICK" );
+          BOOST_CHECK_CLOSE( ticker.latest, 0.004, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.base_volume, 0.01, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.quote_volume, 2.5, 0.0001 );
+          BOOST_CHECK_CLOSE( ticker.percent_change, 100, 0.0001 );
+
+          const auto volume = db_api.get_24_volume( GRAPHENE_SYMBOL, "TICK" );
+          BOOST_CHECK_CLOSE( volume.base_volume, 0.01, 0.0001 );
+          BOOST_CHECK_CLOSE( volume.quote_volume, 2.5, 0.0001 );
+
+      } FC_LOG_AND_RETHROW()
+  }
+
+  BOOST_AUTO_TEST_CASE(api_object_cache_invalidation) {
+      try {
+          ACTORS((nathan)(dan));
+          fund( nathan, asset(10000) );
+          generate_block();
+
+          auto cache = std::make_shared<graphene::app::api_object_cache>( db, 100 );
+          graphene::app::database_api db_api( db, cache );
+          const vector<object_id_type> ids{ nathan_id, dynamic_global_property_id_type() };
+
+          db_api.get_objects( ids );
+          db_api.get_objects( ids );
+          auto stats = db_api.get_object_cache_stats();
+          BOOST_CHECK_EQUAL( stats.misses, 2u );
+          BOOST_CHECK_EQUAL( stats.hits, 2u );
+          BOOST_CHECK_EQUAL( stats.capacity, 100u );
+
+          // a block only drops the objects it changed
+          generate_block();
+          auto objects = db_api.get_objects( ids );
+          stats = db_api.get_object_cache_stats();
+          BOOST_CHECK_EQUAL( stats.misses, 3u );
+          BOOST_CHECK_EQUAL( stats.hits, 3u );
+          BOOST_CHECK_EQUAL( objects[1]["head_block_number"].as_uint64(), db.head_block_num() );
+
+          db_api.get_full_accounts( { "nathan" }, false );
+          db_api.get_full_accounts( { "nathan" }, false );
+          BOOST_CHECK_EQUAL( db_api.get_object_cache_stats().hits, 4u );
+
+          // pending transactions report no changes, so they flush everything
+          transfer( nathan_id, dan_id, asset(1000) );
+          auto accounts = db_api.get_full_accounts( { "nathan" }, false );
+          BOOST_CHECK_EQUAL( accounts["nathan"].balances[0].balance.value, get_balance( nathan_id, asset_id_type() ) );
+          stats = db_api.get_object_cache_stats();
+          BOOST_CHECK_EQUAL( stats.misses, 5u );
+          BOOST_CHECK_EQUAL( stats.size, 1u );
+
+      } FC_LOG_AND_RETHROW()
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,7 +28,10 @@
 
 #include <graphene/chain/account_object.hpp>
 
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
+#include <fc/io/fstream.hpp>
 
 #include "../common/database_fixture.hpp"
 
@@ -81,6 +84,282 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( undo_log_merge_test )
+{
+   try {
+      database db;
+      const auto& kept = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 1;
+      });
+      const auto& doomed = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 2;
+      });
+      const account_balance_id_type kept_id = kept.id;
+      const account_balance_id_type doomed_id = doomed.id;
+
+      auto outer = db._undo_db.start_undo_session();
+      db.modify( kept, [&]( account_balance_object& obj ){ obj.balance = 10; } );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         // second snapshot of the same object must not win over the first one after the merge
+         db.modify( kept, [&]( account_balance_object& obj ){ obj.balance = 20; } );
+         db.remove( doomed );
+         const auto& temp = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+             obj.balance = 3;
+         });
+         db.remove( temp );
+         inner.merge();
+      }
+      BOOST_CHECK_EQUAL( 20, kept_id(db).balance.value );
+      BOOST_CHECK( db.find( doomed_id ) == nullptr );
+
+      const auto& head = db._undo_db.head();
+      BOOST_CHECK_EQUAL( 1u, head.count( undo_record::modified ) );
+      BOOST_CHECK_EQUAL( 1u, head.count( undo_record::removed ) );
+      BOOST_CHECK_EQUAL( 0u, head.count( undo_record::created ) );
+
+      outer.undo();
+      BOOST_CHECK_EQUAL( 1, kept_id(db).balance.value );
+      BOOST_REQUIRE( db.find( doomed_id ) != nullptr );
+      BOOST_CHECK_EQUAL( 2, doomed_id(db).balance.value );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( checkpoint_delta_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      account_balance_id_type kept_id, doomed_id, added_id;
+      {
+         database db;
+         db.object_database::open( data_dir.path() );
+         kept_id = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+             obj.balance = 1;
+         }).id;
+         doomed_id = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+             obj.owner = account_id_type(1);
+             obj.balance = 2;
+         }).id;
+         // nothing on disk yet, this writes a full checkpoint
+         db.flush();
+         BOOST_CHECK( !fc::exists( data_dir.path() / "object_database" / "delta.1" ) );
+
+         db.modify( kept_id(db), [&]( account_balance_object& obj ){ obj.balance = 10; } );
+         db.remove( doomed_id(db) );
+         added_id = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+             obj.owner = account_id_type(2);
+             obj.balance = 3;
+         }).id;
+         db.flush();
+         BOOST_CHECK( fc::exists( data_dir.path() / "object_database" / "delta.1" ) );
+      }
+
+      database db;
+      db.object_database::open( data_dir.path() );
+      BOOST_CHECK_EQUAL( 10, kept_id(db).balance.value );
+      BOOST_CHECK( db.find( doomed_id ) == nullptr );
+      BOOST_REQUIRE( db.find( added_id ) != nullptr );
+      BOOST_CHECK_EQUAL( 3, added_id(db).balance.value );
+      const account_balance_id_type next_id = db.create<account_balance_object>( []( account_balance_object& obj ){
+          obj.owner = account_id_type(3);
+      }).id;
+      BOOST_CHECK( next_id.instance.value == added_id.instance.value + 1 );
+
+      // compaction folds the deltas back into a full checkpoint
+      db.set_max_checkpoint_deltas( 1 );
+      db.flush();
+      BOOST_CHECK( !fc::exists( data_dir.path() / "object_database" / "delta.1" ) );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( checkpoint_delta_matches_full_checkpoint_test )
+{
+   try {
+      // the same changes, flushed as deltas into one directory and as full checkpoints into the other
+      auto apply_round = []( database& db, uint32_t round ) {
+         for( uint32_t i = 0; i < 5; ++i )
+         {
+            const uint32_t n = round * 5 + i;
+            db.create<account_balance_object>( [n]( account_balance_object& obj ){
+                obj.owner = account_id_type(n);
+                obj.balance = n;
+            });
+            db.create<account_statistics_object>( [n]( account_statistics_object& obj ){
+                obj.owner = account_id_type(n);
+                obj.name = "account" + fc::to_string(n);
+            });
+            db.create<asset_dynamic_data_object>( [n]( asset_dynamic_data_object& obj ){
+                obj.current_supply = n;
+            });
+         }
+         vector<object_id_type> ids;
+         db.get_index_type<account_balance_index>().inspect_all_objects( [&ids]( const object& o ){ ids.push_back( o.id ); } );
+         for( const auto& id : ids )
+            if( id.instance() % 2 == 0 )
+               db.modify( db.get<account_balance_object>( id ), []( account_balance_object& obj ){ obj.balance += 100; } );
+         db.remove( db.get<account_balance_object>( ids.front() ) );
+
+         ids.clear();
+         db.get_index_type<account_stats_index>().inspect_all_objects( [&ids]( const object& o ){ ids.push_back( o.id ); } );
+         db.modify( db.get<account_statistics_object>( ids.back() ), [round]( account_statistics_object& obj ){
+             obj.total_ops = round;
+         });
+         db.remove( db.get<account_statistics_object>( ids[round] ) );
+
+         ids.clear();
+         db.get_index_type<primary_index<simple_index<asset_dynamic_data_object>>>().inspect_all_objects(
+               [&ids]( const object& o ){ ids.push_back( o.id ); } );
+         db.remove( db.get<asset_dynamic_data_object>( ids[round] ) );
+      };
+
+      fc::temp_directory delta_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory full_dir( graphene::utilities::temp_directory_path() );
+      {
+         database delta_db;
+         database full_db;
+         full_db.set_max_checkpoint_deltas( 0 );
+         delta_db.object_database::open( delta_dir.path() );
+         full_db.object_database::open( full_dir.path() );
+         for( uint32_t round = 0; round < 4; ++round )
+         {
+            apply_round( delta_db, round );
+            apply_round( full_db, round );
+            delta_db.flush();
+            full_db.flush();
+         }
+         BOOST_CHECK( fc::exists( delta_dir.path() / "object_database" / "delta.3" ) );
+         BOOST_CHECK( !fc::exists( full_dir.path() / "object_database" / "delta.1" ) );
+      }
+
+      database delta_db;
+      database full_db;
+      delta_db.object_database::open( delta_dir.path() );
+      full_db.object_database::open( full_dir.path() );
+      uint32_t compared = 0;
+      full_db.inspect_all_indexes( [&]( const index& full_idx ) {
+         const index& delta_idx = delta_db.get_index( full_idx.object_space_id(), full_idx.object_type_id() );
+         BOOST_CHECK( delta_idx.get_next_id() == full_idx.get_next_id() );
+         std::map< object_id_type, vector<char> > full_objects, delta_objects;
+         full_idx.inspect_all_objects( [&]( const object& o ){ full_objects[o.id] = o.pack(); } );
+         delta_idx.inspect_all_objects( [&]( const object& o ){ delta_objects[o.id] = o.pack(); } );
+         BOOST_CHECK( delta_objects == full_objects );
+         ++compared;
+      });
+      BOOST_CHECK( compared > 0 );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+/** records the fewest accounts seen while the index it is attached to was loading */
+struct account_count_probe : public secondary_index
+{
+   const database* db = nullptr;
+   size_t          min_accounts = std::numeric_limits<size_t>::max();
+
+   virtual void object_inserted( const object& obj ) override
+   {
+      min_accounts = std::min( min_accounts, db->get_index_type<account_index>().indices().size() );
+   }
+};
+
+BOOST_AUTO_TEST_CASE( parallel_checkpoint_test )
+{
+   try {
+      const uint32_t account_count = 10;
+      // enough balances for the index to be encoded and decoded in several chunks
+      const uint32_t balance_count = 25000;
+      auto populate = [&]( database& db ) {
+         for( uint32_t i = 0; i < account_count; ++i )
+            db.create<account_object>( [i]( account_object& obj ){
+                obj.name = "account" + fc::to_string(i);
+                obj.owner.weight_threshold = 1;
+                obj.owner.account_auths[ account_id_type( ( i + 1 ) % account_count ) ] = 1;
+                obj.active = obj.owner;
+            });
+         for( uint32_t i = 0; i < balance_count; ++i )
+            db.create<account_balance_object>( [i]( account_balance_object& obj ){
+                obj.owner = account_id_type(i);
+                obj.balance = i;
+            });
+      };
+      auto add_probe = []( database& db ) {
+         auto& idx = const_cast< primary_index<account_balance_index>& >( db.get_index_type< primary_index<account_balance_index> >() );
+         account_count_probe* probe = idx.add_secondary_index<account_count_probe>();
+         probe->db = &db;
+         return probe;
+      };
+
+      fc::temp_directory parallel_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory serial_dir( graphene::utilities::temp_directory_path() );
+      {
+         database parallel_db;
+         database serial_db;
+         parallel_db.set_checkpoint_threads( 4 );
+         parallel_db.object_database::open( parallel_dir.path() );
+         serial_db.object_database::open( serial_dir.path() );
+         populate( parallel_db );
+         populate( serial_db );
+         parallel_db.flush();
+         serial_db.flush();
+
+         // a chunked save writes exactly the same files as a serial one
+         uint32_t compared = 0;
+         serial_db.inspect_all_indexes( [&]( const index& idx ) {
+            const fc::path file = fc::path( "object_database" ) / fc::to_string( idx.object_space_id() )
+                                                              / fc::to_string( idx.object_type_id() );
+            std::string serial_contents, parallel_contents;
+            fc::read_file_contents( serial_dir.path() / file, serial_contents );
+            fc::read_file_contents( parallel_dir.path() / file, parallel_contents );
+            BOOST_CHECK( parallel_contents == serial_contents );
+            ++compared;
+         });
+         BOOST_CHECK( compared > 0 );
+      }
+
+      database serial_db;
+      database parallel_db;
+      const account_count_probe* serial_probe = add_probe( serial_db );
+      const account_count_probe* parallel_probe = add_probe( parallel_db );
+      parallel_db.set_checkpoint_threads( 4 );
+      serial_db.object_database::open( parallel_dir.path() );
+      parallel_db.object_database::open( parallel_dir.path() );
+
+      // the probe makes the balance index non-isolated, so it is only loaded once all accounts are in
+      BOOST_CHECK_EQUAL( account_count, serial_probe->min_accounts );
+      BOOST_CHECK_EQUAL( account_count, parallel_probe->min_accounts );
+      BOOST_CHECK_EQUAL( balance_count, parallel_db.get_index_type<account_balance_index>().indices().size() );
+
+      serial_db.inspect_all_indexes( [&]( const index& serial_idx ) {
+         const index& parallel_idx = parallel_db.get_index( serial_idx.object_space_id(), serial_idx.object_type_id() );
+         BOOST_CHECK( parallel_idx.get_next_id() == serial_idx.get_next_id() );
+         std::map< object_id_type, vector<char> > serial_objects, parallel_objects;
+         serial_idx.inspect_all_objects( [&]( const object& o ){ serial_objects[o.id] = o.pack(); } );
+         parallel_idx.inspect_all_objects( [&]( const object& o ){ parallel_objects[o.id] = o.pack(); } );
+         BOOST_CHECK( parallel_objects == serial_objects );
+      });
+
+      const auto& serial_members = serial_db.get_index_type< primary_index<account_index> >().get_secondary_index<account_member_index>();
+      const auto& parallel_members = parallel_db.get_index_type< primary_index<account_index> >().get_secondary_index<account_member_index>();
+      BOOST_CHECK_EQUAL( account_count, parallel_members.account_to_account_memberships.size() );
+      BOOST_CHECK( parallel_members.account_to_account_memberships == serial_members.account_to_account_memberships );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( flat_index_test )
 {
    ACTORS((sam));
@@ -195,4 +474,28 @@ BOOST_AUTO_TEST_CASE( direct_index_test )
    // but the secondary has not updated its representation
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( lazy_impacted_accounts_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   transfer( account_id_type(), bob_id, asset( 1000 ) );
+   generate_block();
+
+   uint32_t notifications = 0;
+   flat_set<account_id_type> changed_accounts;
+   // the first slot does not look at the accounts, the second one does
+   boost::signals2::scoped_connection ignore_accounts = db.changed_objects.connect(
+      [&notifications]( const vector<object_id_type>&, const lazy_account_set& ) { ++notifications; } );
+   boost::signals2::scoped_connection collect_accounts = db.changed_objects.connect(
+      [&changed_accounts]( const vector<object_id_type>&, const lazy_account_set& accounts ) {
+         changed_accounts.insert( accounts.get().begin(), accounts.get().end() );
+      } );
+
+   transfer( account_id_type(), bob_id, asset( 1000 ) );
+   generate_block();
+
+   BOOST_CHECK_GT( notifications, 0u );
+   BOOST_CHECK( changed_accounts.find( bob_id ) != changed_accounts.end() );
+   BOOST_CHECK( changed_accounts.find( alice_id ) == changed_accounts.end() );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
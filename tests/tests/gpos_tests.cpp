@@ -1341,6 +1341,59 @@ BOOST_AUTO_TEST_CASE( proxy_voting )
    }
 }
 
+BOOST_AUTO_TEST_CASE( parallel_vote_tally )
+{
+   ACTORS((alice)(bob)(carol)(dave));
+   try {
+      // move to hardfork
+      generate_blocks( HARDFORK_GPOS_TIME );
+      generate_block();
+
+      const auto& core = asset_id_type()(db);
+      update_maintenance_interval(3600);
+      update_gpos_global(518400, 86400, db.head_block_time());
+
+      // every account gets a different stake and votes for a different witness, bob shares one with alice
+      const vector<std::pair<account_id_type, fc::ecc::private_key>> voters = {
+         { alice_id, alice_private_key }, { bob_id, bob_private_key },
+         { carol_id, carol_private_key }, { dave_id, dave_private_key } };
+      for( size_t i = 0; i < voters.size(); ++i )
+      {
+         transfer( committee_account, voters[i].first, core.amount( 1000 * (i + 1) ) );
+         create_vesting( voters[i].first, core.amount( 100 * (i + 1) ), vesting_balance_type::gpos );
+         vote_for( voters[i].first, witness_id_type( std::max<size_t>( i, 1 ) )(db).vote_id, voters[i].second );
+      }
+      generate_block();
+
+      // leave the GPOS transition period, from then on the votes are counted after the account walk
+      generate_blocks( HARDFORK_GPOS_TIME + 43200 );
+
+      auto witness_votes = [&]() {
+         vector<uint64_t> votes;
+         for( size_t i = 1; i < voters.size(); ++i )
+            votes.push_back( witness_id_type(i)(db).total_votes );
+         return votes;
+      };
+
+      db.set_vote_tally_threads(4);
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      const auto parallel_votes = witness_votes();
+      BOOST_CHECK_EQUAL( parallel_votes[0], 300u );
+      BOOST_CHECK_EQUAL( parallel_votes[1], 300u );
+      BOOST_CHECK_EQUAL( parallel_votes[2], 400u );
+
+      // nothing changed and the vesting factor is still 1, the serial tally has to agree
+      db.set_vote_tally_threads(0);
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      const auto serial_votes = witness_votes();
+      BOOST_CHECK( parallel_votes == serial_votes );
+   }
+   catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( no_proposal )
 {
    try {
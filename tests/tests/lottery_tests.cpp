@@ -543,4 +543,58 @@ BOOST_AUTO_TEST_CASE( lottery_winner_ticket_id_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( ending_lotteries_order_test )
+{
+   try {
+      generate_block();
+      const time_point_sec now = db.head_block_time();
+      int count = 0;
+      auto create_lottery = [&]( time_point_sec end_date, bool ending_on_soldout ) {
+         const auto& dynamic_data = db.create<asset_dynamic_data_object>( []( asset_dynamic_data_object& ){} );
+         return db.create<asset_object>( [&]( asset_object& a ) {
+            a.symbol = "LOTTERY" + fc::to_string( count++ );
+            a.issuer = account_id_type();
+            a.options.max_supply = 200;
+            a.dynamic_asset_data_id = dynamic_data.id;
+            lottery_asset_options options;
+            options.end_date = end_date;
+            options.ending_on_soldout = ending_on_soldout;
+            options.is_active = true;
+            a.lottery_options = options;
+         }).get_id();
+      };
+      auto is_active = [&]( asset_id_type id ) {
+         return id( db ).lottery_options->is_active;
+      };
+
+      asset_id_type soldout_only = create_lottery( time_point_sec(), true );
+      asset_id_type earliest = create_lottery( now - 10, false );
+      asset_id_type latest_older = create_lottery( now - 5, false );
+      asset_id_type latest_newer = create_lottery( now - 5, false );
+      asset_id_type not_due = create_lottery( now + 1000, false );
+
+      // one per call: the latest due end date first, the oldest lottery first among equal end dates
+      db.check_ending_lotteries();
+      BOOST_CHECK( !is_active( latest_older ) );
+      BOOST_CHECK( is_active( latest_newer ) );
+      BOOST_CHECK( is_active( earliest ) );
+
+      db.check_ending_lotteries();
+      BOOST_CHECK( !is_active( latest_newer ) );
+      BOOST_CHECK( is_active( earliest ) );
+
+      db.check_ending_lotteries();
+      BOOST_CHECK( !is_active( earliest ) );
+
+      // nothing else is due, and a lottery without an end date only ends when sold out
+      db.check_ending_lotteries();
+      db.check_ending_lotteries();
+      BOOST_CHECK( is_active( not_due ) );
+      BOOST_CHECK( is_active( soldout_only ) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()